@@ -20,6 +20,7 @@ public class LightLock : ModuleRules
             {
                 "CoreUObject",
                 "Engine",
+                "Json",
             }
         );
     }
@@ -0,0 +1,98 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockAccessTracker.h"
+
+FLightLockAccessTracker::FLightLockAccessTracker(int32 InNumSlots)
+{
+    uint32 NumSets = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(InNumSlots / WAYS, 1)));
+    SetShift = 32 - FMath::FloorLog2(NumSets);
+    Slots = MakeShared<TArray<FSlot>>();
+    Slots->SetNum(NumSets * WAYS);
+}
+
+float FLightLockAccessTracker::GetScore(const FSlot& Slot, uint32 Frame)
+{
+    return Slot.Hits * FMath::Exp2(-static_cast<float>(Frame - Slot.LastFrame) / HALF_LIFE_FRAMES);
+}
+
+void FLightLockAccessTracker::Record(uint32 Hash, uint32 Frame)
+{
+    // A 32-bit shift is undefined, so a single set takes index 0 explicitly.
+    uint32 Set = SetShift < 32 ? (Hash * 0x9E3779B1u) >> SetShift : 0;
+    if (!Slots.IsUnique())
+    {
+        // A snapshot still reads these slots.
+        Slots = MakeShared<TArray<FSlot>>(*Slots);
+    }
+    FSlot* Ways = &(*Slots)[Set * WAYS];
+    FSlot* Weakest = &Ways[0];
+    float WeakestScore = FLT_MAX;
+    for (int32 i = 0; i < WAYS; ++i)
+    {
+        FSlot& Slot = Ways[i];
+        if (Slot.Hits > 0 && Slot.Hash == Hash)
+        {
+            Slot.Hits = FMath::Min<uint32>(Slot.Hits + 1, MAX_uint16);
+            Slot.LastFrame = Frame;
+            return;
+        }
+        float Score = Slot.Hits > 0 ? GetScore(Slot, Frame) : -1.0f;
+        if (Score < WeakestScore)
+        {
+            WeakestScore = Score;
+            Weakest = &Slot;
+        }
+    }
+    Weakest->Hash = Hash;
+    Weakest->LastFrame = Frame;
+    Weakest->Hits = 1;
+}
+
+void FLightLockAccessTracker::GetHotSet(uint32 Frame, TArray<uint32>& OutHashes) const
+{
+    CollectHotSet(*Slots, Frame, OutHashes);
+}
+
+void FLightLockAccessTracker::FSnapshot::GetHotSet(uint32 Frame, TArray<uint32>& OutHashes) const
+{
+    OutHashes.Reset();
+    if (Slots.IsValid()) CollectHotSet(*Slots, Frame, OutHashes);
+}
+
+FLightLockAccessTracker::FSnapshot FLightLockAccessTracker::Snapshot() const
+{
+    FSnapshot Result;
+    Result.Slots = Slots;
+    return Result;
+}
+
+void FLightLockAccessTracker::CollectHotSet(const TArray<FSlot>& InSlots, uint32 Frame, TArray<uint32>& OutHashes)
+{
+    TArray<TPair<float, uint32>> Scored;
+    Scored.Reserve(InSlots.Num());
+    for (const FSlot& Slot : InSlots)
+    {
+        if (Slot.Hits > 0) Scored.Emplace(GetScore(Slot, Frame), Slot.Hash);
+    }
+    Scored.Sort([](const TPair<float, uint32>& A, const TPair<float, uint32>& B) { return A.Key > B.Key; });
+    OutHashes.Reset(Scored.Num());
+    for (const TPair<float, uint32>& Entry : Scored)
+    {
+        OutHashes.Add(Entry.Value);
+    }
+}
+
+void FLightLockAccessTracker::Reset()
+{
+    if (!Slots.IsUnique())
+    {
+        int32 NumSlots = Slots->Num();
+        Slots = MakeShared<TArray<FSlot>>();
+        Slots->SetNum(NumSlots);
+        return;
+    }
+    for (FSlot& Slot : *Slots)
+    {
+        Slot = FSlot();
+    }
+}
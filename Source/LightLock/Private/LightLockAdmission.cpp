@@ -0,0 +1,60 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockAdmission.h"
+
+static constexpr uint32 ROW_SEEDS[4] = { 0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu };
+
+FLightLockAdmissionFilter::FLightLockAdmissionFilter(int32 InCountersPerRow, int32 InAgingFrames)
+{
+    uint32 CountersPerRow = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(InCountersPerRow, COUNTERS_PER_WORD)));
+    RowShift = 32 - FMath::FloorLog2(CountersPerRow);
+    WordsPerRow = CountersPerRow / COUNTERS_PER_WORD;
+    NumWords = WordsPerRow * DEPTH;
+    AgingStride = FMath::DivideAndRoundUp<uint32>(NumWords, static_cast<uint32>(FMath::Max(InAgingFrames, 1)));
+    Words = MakeUnique<std::atomic<uint64>[]>(NumWords);
+    for (uint32 i = 0; i < NumWords; ++i)
+    {
+        Words[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32 FLightLockAdmissionFilter::GetCounterIndex(uint32 Hash, int32 Row) const
+{
+    return Row * WordsPerRow * COUNTERS_PER_WORD + ((Hash * ROW_SEEDS[Row]) >> RowShift);
+}
+
+void FLightLockAdmissionFilter::Record(uint32 Hash)
+{
+    for (int32 Row = 0; Row < DEPTH; ++Row)
+    {
+        uint32 Counter = GetCounterIndex(Hash, Row);
+        std::atomic<uint64>& Word = Words[Counter / COUNTERS_PER_WORD];
+        uint32 Shift = (Counter % COUNTERS_PER_WORD) * 4;
+        uint64 Old = Word.load(std::memory_order_relaxed);
+        while (((Old >> Shift) & 0xF) != 0xF && !Word.compare_exchange_weak(Old, Old + (1ull << Shift), std::memory_order_relaxed)) {}
+    }
+}
+
+uint32 FLightLockAdmissionFilter::Estimate(uint32 Hash) const
+{
+    uint32 Min = 0xF;
+    for (int32 Row = 0; Row < DEPTH; ++Row)
+    {
+        uint32 Counter = GetCounterIndex(Hash, Row);
+        uint64 Word = Words[Counter / COUNTERS_PER_WORD].load(std::memory_order_relaxed);
+        Min = FMath::Min<uint32>(Min, (Word >> ((Counter % COUNTERS_PER_WORD) * 4)) & 0xF);
+    }
+    return Min;
+}
+
+void FLightLockAdmissionFilter::Age()
+{
+    // Called from AdvanceFrame only; Record may race, so halve with CAS rather than a plain store.
+    for (uint32 i = 0; i < AgingStride; ++i)
+    {
+        std::atomic<uint64>& Word = Words[AgingCursor];
+        uint64 Old = Word.load(std::memory_order_relaxed);
+        while (!Word.compare_exchange_weak(Old, (Old >> 1) & 0x7777777777777777ull, std::memory_order_relaxed)) {}
+        AgingCursor = (AgingCursor + 1) % NumWords;
+    }
+}
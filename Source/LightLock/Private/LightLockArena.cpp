@@ -0,0 +1,84 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockArena.h"
+
+FLightLockArena::FLightLockArena(SIZE_T InBlockSize)
+    : BlockSize(FMath::Max<SIZE_T>(InBlockSize, MAX_SMALL_SIZE))
+{
+}
+
+FLightLockArena::~FLightLockArena()
+{
+    Reset();
+}
+
+void* FLightLockArena::Allocate(SIZE_T Size, SIZE_T Alignment)
+{
+    Size = FMath::Max<SIZE_T>(Size, 1);
+    if (Size > MAX_SMALL_SIZE)
+    {
+        void* Ptr = FMemory::Malloc(Size, FMath::Max<SIZE_T>(Alignment, SIZE_CLASS_GRANULARITY));
+        LargeAllocations.Add(Ptr);
+        LargeBytes += Size;
+        UsedBytes += Size;
+        return Ptr;
+    }
+    
+    checkSlow(Alignment <= SIZE_CLASS_GRANULARITY);
+    int32 SizeClass = static_cast<int32>((Size - 1) / SIZE_CLASS_GRANULARITY);
+    SIZE_T ClassSize = (SizeClass + 1) * SIZE_CLASS_GRANULARITY;
+    UsedBytes += ClassSize;
+    if (FFreeNode* Node = FreeLists[SizeClass])
+    {
+        FreeLists[SizeClass] = Node->Next;
+        return Node;
+    }
+    if (Cursor == nullptr || static_cast<SIZE_T>(BlockEnd - Cursor) < ClassSize)
+    {
+        uint8* Block = static_cast<uint8*>(FMemory::Malloc(BlockSize, SIZE_CLASS_GRANULARITY));
+        Blocks.Add(Block);
+        Cursor = Block;
+        BlockEnd = Block + BlockSize;
+    }
+    void* Result = Cursor;
+    Cursor += ClassSize;
+    return Result;
+}
+
+void FLightLockArena::Free(void* Ptr, SIZE_T Size)
+{
+    if (!Ptr) return;
+    Size = FMath::Max<SIZE_T>(Size, 1);
+    if (Size > MAX_SMALL_SIZE)
+    {
+        LargeAllocations.Remove(Ptr);
+        FMemory::Free(Ptr);
+        LargeBytes -= Size;
+        UsedBytes -= Size;
+        return;
+    }
+    int32 SizeClass = static_cast<int32>((Size - 1) / SIZE_CLASS_GRANULARITY);
+    FFreeNode* Node = static_cast<FFreeNode*>(Ptr);
+    Node->Next = FreeLists[SizeClass];
+    FreeLists[SizeClass] = Node;
+    UsedBytes -= (SizeClass + 1) * SIZE_CLASS_GRANULARITY;
+}
+
+void FLightLockArena::Reset()
+{
+    for (uint8* Block : Blocks)
+    {
+        FMemory::Free(Block);
+    }
+    for (void* Ptr : LargeAllocations)
+    {
+        FMemory::Free(Ptr);
+    }
+    Blocks.Reset();
+    LargeAllocations.Reset();
+    FMemory::Memzero(FreeLists);
+    Cursor = nullptr;
+    BlockEnd = nullptr;
+    LargeBytes = 0;
+    UsedBytes = 0;
+}
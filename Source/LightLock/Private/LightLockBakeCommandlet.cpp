@@ -0,0 +1,495 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockBakeCommandlet.h"
+#include "LightLockBake.h"
+#include "LightLockCore.h"
+#include "Async/ParallelFor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "StaticMeshResources.h"
+#include "CollisionQueryParams.h"
+#include "Math/RandomStream.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/Package.h"
+#include "Algo/Sort.h"
+
+static FCriticalSection GBakeEvaluatorMutex;
+static TMap<FName, FLightLockBakeEvaluator> GBakeEvaluators;
+
+void FLightLockBakeEvaluators::Register(FName Name, FLightLockBakeEvaluator Evaluator)
+{
+    FScopeLock Lock(&GBakeEvaluatorMutex);
+    GBakeEvaluators.Add(Name, MoveTemp(Evaluator));
+}
+
+void FLightLockBakeEvaluators::Unregister(FName Name)
+{
+    FScopeLock Lock(&GBakeEvaluatorMutex);
+    GBakeEvaluators.Remove(Name);
+}
+
+FLightLockBakeEvaluator FLightLockBakeEvaluators::Find(FName Name)
+{
+    FScopeLock Lock(&GBakeEvaluatorMutex);
+    const FLightLockBakeEvaluator* Found = GBakeEvaluators.Find(Name);
+    return Found ? *Found : FLightLockBakeEvaluator();
+}
+
+TArray<FName> FLightLockBakeEvaluators::GetNames()
+{
+    FScopeLock Lock(&GBakeEvaluatorMutex);
+    TArray<FName> Names;
+    GBakeEvaluators.GetKeys(Names);
+    return Names;
+}
+
+namespace LightLockBake
+{
+    static constexpr uint32 PROGRESS_MAGIC = 0x4C4C4250;
+    static constexpr uint32 PROGRESS_VERSION = 1;
+    static constexpr uint32 CHUNK_END_MARKER = 0x4C4C4245;
+    static const FName SKY_OCCLUSION_EVALUATOR(TEXT("SkyOcclusion"));
+
+    struct FSettings
+    {
+        FString Map;
+        float Spacing = 50.0f;
+        bool bLightmap = false;
+        FName Evaluator = SKY_OCCLUSION_EVALUATOR;
+        int32 Rays = 16;
+        float Precision = 0.01f;
+        int32 BatchSize = 65536;
+        FLightLockEnvironmentKey Environment;
+        FString OutputPath;
+        bool bResume = false;
+    };
+
+    // Built-in fallback: cosine-weighted sky visibility against the world's collision. A baseline so a bake
+    // produces something useful out of the box; projects register evaluators that call their own lighting.
+    static FLightLockBakeEvaluator MakeSkyOcclusionEvaluator(int32 Rays, float MaxDistance)
+    {
+        return [Rays, MaxDistance](UWorld* World, const FLightLockBakeSample& Sample, FLightLockBakeResult& OutResult)
+        {
+            FCollisionQueryParams Params(SCENE_QUERY_STAT(LightLockBake), false);
+            FVector Tangent, Bitangent;
+            Sample.Normal.FindBestAxisVectors(Tangent, Bitangent);
+            FVector Origin = Sample.Position + Sample.Normal;
+            FRandomStream Random(static_cast<int32>(Sample.Hash));
+            int32 Visible = 0;
+            for (int32 i = 0; i < Rays; ++i)
+            {
+                float U1 = Random.GetFraction();
+                float Radius = FMath::Sqrt(U1);
+                float Phi = 2.0f * PI * Random.GetFraction();
+                FVector Direction = Tangent * (Radius * FMath::Cos(Phi)) + Bitangent * (Radius * FMath::Sin(Phi)) + Sample.Normal * FMath::Sqrt(1.0f - U1);
+                if (!World->LineTraceTestByChannel(Origin, Origin + Direction * MaxDistance, ECC_Visibility, Params))
+                {
+                    Visible++;
+                }
+            }
+            float Visibility = Rays > 0 ? static_cast<float>(Visible) / Rays : 1.0f;
+            OutResult.Color = FLinearColor(Visibility, Visibility, Visibility, 1.0f);
+            OutResult.BounceCount = 1;
+            OutResult.Confidence = 1.0f;
+            return true;
+        };
+    }
+
+    static UWorld* LoadWorld(const FString& MapName)
+    {
+        UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+        UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+        if (!World) return nullptr;
+
+        World->AddToRoot();
+        World->WorldType = EWorldType::Editor;
+        FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Editor);
+        Context.SetCurrentWorld(World);
+        if (!World->bIsWorldInitialized)
+        {
+            World->InitWorld(UWorld::InitializationValues()
+                .AllowAudioPlayback(false)
+                .RequiresHitProxies(false)
+                .CreatePhysicsScene(true)
+                .CreateNavigation(false)
+                .CreateAISystem(false)
+                .ShouldSimulatePhysics(false)
+                .SetTransactional(false));
+        }
+#if WITH_EDITOR
+        World->LoadSecondaryLevels();
+#endif
+        World->UpdateWorldComponents(true, false);
+        return World;
+    }
+
+    static void UnloadWorld(UWorld* World)
+    {
+        GEngine->DestroyWorldContext(World);
+        World->DestroyWorld(false);
+        World->RemoveFromRoot();
+    }
+
+    static void GatherSamples(UWorld* World, const FSettings& Settings, TArray<FLightLockBakeSample>& OutSamples)
+    {
+        TSet<uint32> Seen;
+        float SampleArea = Settings.Spacing * Settings.Spacing;
+        for (ULevel* Level : World->GetLevels())
+        {
+            for (AActor* Actor : Level->Actors)
+            {
+                if (!Actor) continue;
+                TInlineComponentArray<UStaticMeshComponent*> Components(Actor);
+                for (UStaticMeshComponent* Component : Components)
+                {
+                    if (Component->Mobility != EComponentMobility::Static) continue;
+                    UStaticMesh* Mesh = Component->GetStaticMesh();
+                    const FStaticMeshRenderData* RenderData = Mesh ? Mesh->GetRenderData() : nullptr;
+                    if (!RenderData || RenderData->LODResources.Num() == 0) continue;
+
+                    const FStaticMeshLODResources& LOD = RenderData->LODResources[0];
+                    const FPositionVertexBuffer& Positions = LOD.VertexBuffers.PositionVertexBuffer;
+                    const FStaticMeshVertexBuffer& Vertices = LOD.VertexBuffers.StaticMeshVertexBuffer;
+                    FIndexArrayView Indices = LOD.IndexBuffer.GetArrayView();
+                    if (Indices.Num() == 0 || Positions.GetNumVertices() == 0) continue;
+
+                    FTransform Transform = Component->GetComponentTransform();
+                    uint32 MeshID = GetTypeHash(Component->GetPathName());
+                    int32 LightmapUVIndex = Mesh->GetLightMapCoordinateIndex();
+                    bool bUseLightmap = Settings.bLightmap && LightmapUVIndex < static_cast<int32>(Vertices.GetNumTexCoords());
+                    int32 LightmapWidth = 0;
+                    int32 LightmapHeight = 0;
+                    Component->GetLightMapResolution(LightmapWidth, LightmapHeight);
+                    uint32 LightmapResolution = static_cast<uint32>(FMath::Max(LightmapWidth, 1));
+
+                    // Seeded per component so the sample list (and therefore -Resume) is reproducible.
+                    FRandomStream Random(static_cast<int32>(MeshID));
+                    for (int32 Tri = 0; Tri + 2 < Indices.Num(); Tri += 3)
+                    {
+                        uint32 I[3] = { Indices[Tri], Indices[Tri + 1], Indices[Tri + 2] };
+                        FVector P[3];
+                        FVector VertexNormalSum = FVector::ZeroVector;
+                        for (int32 k = 0; k < 3; ++k)
+                        {
+                            P[k] = Transform.TransformPosition(FVector(Positions.VertexPosition(I[k])));
+                            VertexNormalSum += Transform.TransformVectorNoScale(FVector(Vertices.VertexTangentZ(I[k])));
+                        }
+                        FVector Cross = (P[1] - P[0]) ^ (P[2] - P[0]);
+                        double Area = Cross.Size() * 0.5;
+                        if (Area < KINDA_SMALL_NUMBER) continue;
+                        FVector Normal = Cross.GetUnsafeNormal();
+                        if ((Normal | VertexNormalSum) < 0.0) Normal = -Normal;
+
+                        int32 Count = FMath::Max(1, FMath::RoundToInt(Area / SampleArea));
+                        for (int32 s = 0; s < Count; ++s)
+                        {
+                            float SqrtU = FMath::Sqrt(Random.GetFraction());
+                            float V = Random.GetFraction();
+                            float B0 = 1.0f - SqrtU;
+                            float B1 = SqrtU * (1.0f - V);
+                            float B2 = SqrtU * V;
+
+                            FLightLockBakeSample Sample;
+                            Sample.Position = P[0] * B0 + P[1] * B1 + P[2] * B2;
+                            Sample.Normal = Normal;
+                            if (bUseLightmap)
+                            {
+                                FVector2D UV = FVector2D(Vertices.GetVertexUV(I[0], LightmapUVIndex)) * B0
+                                    + FVector2D(Vertices.GetVertexUV(I[1], LightmapUVIndex)) * B1
+                                    + FVector2D(Vertices.GetVertexUV(I[2], LightmapUVIndex)) * B2;
+                                Sample.Hash = FLightLockHasher::HashLightmapSpace(MeshID, UV, LightmapResolution);
+                            }
+                            else
+                            {
+                                Sample.Hash = FLightLockHasher::HashWorldSpace(Sample.Position, Sample.Normal, Settings.Precision);
+                            }
+                            bool bAlreadySeen = false;
+                            Seen.Add(Sample.Hash, &bAlreadySeen);
+                            if (!bAlreadySeen)
+                            {
+                                OutSamples.Add(Sample);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    static uint32 ComputeFingerprint(const FSettings& Settings, const TArray<FLightLockBakeSample>& Samples)
+    {
+        uint32 Hash = GetTypeHash(Settings.Map);
+        Hash = HashCombine(Hash, GetTypeHash(Settings.Spacing));
+        Hash = HashCombine(Hash, GetTypeHash(Settings.bLightmap));
+        Hash = HashCombine(Hash, GetTypeHash(Settings.Evaluator));
+        Hash = HashCombine(Hash, GetTypeHash(Settings.Rays));
+        Hash = HashCombine(Hash, GetTypeHash(Settings.Precision));
+        Hash = HashCombine(Hash, GetTypeHash(Settings.Environment));
+        Hash = HashCombine(Hash, GetTypeHash(static_cast<uint32>(sizeof(FLightPath))));
+        Hash = HashCombine(Hash, GetTypeHash(Samples.Num()));
+        for (const FLightLockBakeSample& Sample : Samples)
+        {
+            Hash = HashCombine(Hash, Sample.Hash);
+        }
+        return Hash;
+    }
+
+    // Progress file: header, then one chunk per completed batch holding the sample index and entry of every
+    // evaluated sample. Chunks end with a marker so a batch cut short by a crash is discarded on resume.
+    struct FProgress
+    {
+        TArray<FLightLockCacheEntry> Entries;
+        TBitArray<> Valid;
+        TBitArray<> CompletedBatches;
+    };
+
+    static void SerializeProgressHeader(FArchive& Ar, uint32& Magic, uint32& Version, uint32& Fingerprint, uint32& BatchSize, uint32& NumSamples)
+    {
+        Ar << Magic << Version << Fingerprint << BatchSize << NumSamples;
+    }
+
+    static void WriteChunk(FArchive& Ar, const FProgress& Progress, int32 Batch, int32 BatchSize)
+    {
+        int32 First = Batch * BatchSize;
+        int32 Last = FMath::Min(First + BatchSize, Progress.Entries.Num());
+        uint32 BatchIndex = Batch;
+        uint32 Count = 0;
+        for (int32 i = First; i < Last; ++i)
+        {
+            Count += Progress.Valid[i] ? 1 : 0;
+        }
+        Ar << BatchIndex << Count;
+        for (int32 i = First; i < Last; ++i)
+        {
+            if (!Progress.Valid[i]) continue;
+            uint32 SampleIndex = i;
+            FLightLockCacheEntry Entry = Progress.Entries[i];
+            Ar << SampleIndex << Entry.Hash;
+            Ar.Serialize(&Entry.Path, sizeof(FLightPath));
+        }
+        uint32 Marker = CHUNK_END_MARKER;
+        Ar << Marker;
+    }
+
+    static int32 ReadProgress(const FString& Path, uint32 Fingerprint, int32 BatchSize, FProgress& Progress)
+    {
+        TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+        if (!Reader) return 0;
+
+        uint32 Magic = 0, Version = 0, FileFingerprint = 0, FileBatchSize = 0, NumSamples = 0;
+        SerializeProgressHeader(*Reader, Magic, Version, FileFingerprint, FileBatchSize, NumSamples);
+        if (Reader->IsError() || Magic != PROGRESS_MAGIC || Version != PROGRESS_VERSION || FileFingerprint != Fingerprint
+            || FileBatchSize != static_cast<uint32>(BatchSize) || NumSamples != static_cast<uint32>(Progress.Entries.Num()))
+        {
+            UE_LOG(LogTemp, Warning, TEXT("LightLock Bake: %s does not match this map and settings, starting over"), *Path);
+            return 0;
+        }
+
+        int32 Restored = 0;
+        while (!Reader->AtEnd())
+        {
+            uint32 BatchIndex = 0, Count = 0;
+            *Reader << BatchIndex << Count;
+            if (Reader->IsError() || BatchIndex >= static_cast<uint32>(Progress.CompletedBatches.Num()) || Count > static_cast<uint32>(BatchSize)) break;
+
+            TArray<TPair<uint32, FLightLockCacheEntry>> Chunk;
+            Chunk.Reserve(Count);
+            for (uint32 i = 0; i < Count; ++i)
+            {
+                uint32 SampleIndex = 0;
+                FLightLockCacheEntry Entry;
+                *Reader << SampleIndex << Entry.Hash;
+                Reader->Serialize(&Entry.Path, sizeof(FLightPath));
+                Chunk.Emplace(SampleIndex, Entry);
+            }
+            uint32 Marker = 0;
+            *Reader << Marker;
+            if (Reader->IsError() || Marker != CHUNK_END_MARKER) break;
+
+            for (const TPair<uint32, FLightLockCacheEntry>& Pair : Chunk)
+            {
+                if (Pair.Key >= static_cast<uint32>(Progress.Entries.Num())) continue;
+                Progress.Entries[Pair.Key] = Pair.Value;
+                Progress.Valid[Pair.Key] = true;
+            }
+            Progress.CompletedBatches[BatchIndex] = true;
+            Restored++;
+        }
+        return Restored;
+    }
+}
+
+using namespace LightLockBake;
+
+ULightLockBakeCommandlet::ULightLockBakeCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = true;
+    LogToConsole = true;
+}
+
+int32 ULightLockBakeCommandlet::Main(const FString& Params)
+{
+    FSettings Settings;
+    if (!FParse::Value(*Params, TEXT("Map="), Settings.Map))
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Bake: Missing -Map=<package>"));
+        return 1;
+    }
+    FParse::Value(*Params, TEXT("Spacing="), Settings.Spacing);
+    Settings.Spacing = FMath::Max(Settings.Spacing, 1.0f);
+    Settings.bLightmap = FParse::Param(*Params, TEXT("Lightmap"));
+    FString EvaluatorName;
+    if (FParse::Value(*Params, TEXT("Evaluator="), EvaluatorName))
+    {
+        Settings.Evaluator = FName(*EvaluatorName);
+    }
+    FParse::Value(*Params, TEXT("Rays="), Settings.Rays);
+    FParse::Value(*Params, TEXT("Precision="), Settings.Precision);
+    FParse::Value(*Params, TEXT("BatchSize="), Settings.BatchSize);
+    Settings.BatchSize = FMath::Max(Settings.BatchSize, 1);
+    FParse::Value(*Params, TEXT("TimeOfDayBucket="), Settings.Environment.TimeOfDayBucket);
+    FParse::Value(*Params, TEXT("LightSetHash="), Settings.Environment.LightSetHash);
+    FString Output = TEXT("LightLock/cache.bin");
+    FParse::Value(*Params, TEXT("Output="), Output);
+    Settings.OutputPath = FPaths::IsRelative(Output) ? FPaths::ProjectSavedDir() / Output : Output;
+    Settings.bResume = FParse::Param(*Params, TEXT("Resume"));
+
+    FLightLockBakeEvaluator Evaluator = FLightLockBakeEvaluators::Find(Settings.Evaluator);
+    if (!Evaluator && Settings.Evaluator == SKY_OCCLUSION_EVALUATOR)
+    {
+        Evaluator = MakeSkyOcclusionEvaluator(Settings.Rays, 100000.0f);
+    }
+    if (!Evaluator)
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Bake: Unknown evaluator %s"), *Settings.Evaluator.ToString());
+        return 1;
+    }
+
+    UWorld* World = LoadWorld(Settings.Map);
+    if (!World)
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Bake: Failed to load %s"), *Settings.Map);
+        return 1;
+    }
+
+    TArray<FLightLockBakeSample> Samples;
+    GatherSamples(World, Settings, Samples);
+    int32 NumBatches = FMath::DivideAndRoundUp(Samples.Num(), Settings.BatchSize);
+    UE_LOG(LogTemp, Display, TEXT("LightLock Bake: %d samples in %d batches"), Samples.Num(), NumBatches);
+
+    FProgress Progress;
+    Progress.Entries.SetNum(Samples.Num());
+    Progress.Valid.Init(false, Samples.Num());
+    Progress.CompletedBatches.Init(false, NumBatches);
+    uint32 Fingerprint = ComputeFingerprint(Settings, Samples);
+    FString ProgressPath = Settings.OutputPath + TEXT(".progress");
+    if (Settings.bResume)
+    {
+        int32 Restored = ReadProgress(ProgressPath, Fingerprint, Settings.BatchSize, Progress);
+        UE_LOG(LogTemp, Display, TEXT("LightLock Bake: Resumed %d of %d batches"), Restored, NumBatches);
+    }
+
+    // Rewrite the progress file with only the intact chunks, then append as batches complete. The rewrite goes
+    // to a temp file renamed over the old one, so a crash mid-rewrite still leaves the restored chunks on disk.
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(ProgressPath), true);
+    FString ProgressTempPath = ProgressPath + TEXT(".tmp");
+    TUniquePtr<FArchive> ProgressWriter(IFileManager::Get().CreateFileWriter(*ProgressTempPath));
+    if (ProgressWriter)
+    {
+        uint32 Magic = PROGRESS_MAGIC, Version = PROGRESS_VERSION, BatchSize = Settings.BatchSize, NumSamples = Samples.Num();
+        SerializeProgressHeader(*ProgressWriter, Magic, Version, Fingerprint, BatchSize, NumSamples);
+        for (int32 Batch = 0; Batch < NumBatches; ++Batch)
+        {
+            if (Progress.CompletedBatches[Batch]) WriteChunk(*ProgressWriter, Progress, Batch, Settings.BatchSize);
+        }
+        bool bWritten = ProgressWriter->Close();
+        ProgressWriter.Reset();
+        if (bWritten && IFileManager::Get().Move(*ProgressPath, *ProgressTempPath, true, true))
+        {
+            ProgressWriter.Reset(IFileManager::Get().CreateFileWriter(*ProgressPath, FILEWRITE_Append));
+        }
+        else
+        {
+            IFileManager::Get().Delete(*ProgressTempPath, false, true, true);
+        }
+    }
+    if (!ProgressWriter)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock Bake: Could not write %s; this bake cannot be resumed"), *ProgressPath);
+    }
+
+    double StartTime = FPlatformTime::Seconds();
+    int32 BatchesRun = 0;
+    for (int32 Batch = 0; Batch < NumBatches; ++Batch)
+    {
+        if (Progress.CompletedBatches[Batch]) continue;
+        int32 First = Batch * Settings.BatchSize;
+        int32 Count = FMath::Min(Settings.BatchSize, Samples.Num() - First);
+        TArray<uint8> Evaluated;
+        Evaluated.SetNumZeroed(Count);
+        ParallelFor(Count, [&](int32 i)
+        {
+            const FLightLockBakeSample& Sample = Samples[First + i];
+            FLightLockBakeResult Result;
+            if (Evaluator(World, Sample, Result))
+            {
+                FLightLockCacheEntry& Entry = Progress.Entries[First + i];
+                Entry.Hash = Sample.Hash;
+                Entry.Path = FLightPath::Create(Result.Color, Result.Weight, Sample.Position, Sample.Normal, Result.BounceCount, Result.Confidence);
+                Evaluated[i] = 1;
+            }
+        });
+        for (int32 i = 0; i < Count; ++i)
+        {
+            Progress.Valid[First + i] = Evaluated[i] != 0;
+        }
+        Progress.CompletedBatches[Batch] = true;
+        if (ProgressWriter)
+        {
+            WriteChunk(*ProgressWriter, Progress, Batch, Settings.BatchSize);
+            ProgressWriter->Flush();
+        }
+
+        BatchesRun++;
+        double Elapsed = FPlatformTime::Seconds() - StartTime;
+        int32 Remaining = NumBatches - Batch - 1;
+        UE_LOG(LogTemp, Display, TEXT("LightLock Bake: Batch %d/%d done (%.1fs elapsed, ~%.0fs left)"),
+            Batch + 1, NumBatches, Elapsed, Elapsed / BatchesRun * Remaining);
+    }
+    ProgressWriter.Reset();
+
+    // Same Morton order as the runtime static table, so the file loads without reshuffling and gets a tile directory.
+    TArray<int32> Order;
+    TArray<uint64> MortonCodes;
+    MortonCodes.SetNumUninitialized(Samples.Num());
+    for (int32 i = 0; i < Samples.Num(); ++i)
+    {
+        MortonCodes[i] = FLightLockStaticTable::GetMortonCode(Progress.Entries[i].Path);
+        if (Progress.Valid[i]) Order.Add(i);
+    }
+    Algo::SortBy(Order, [&MortonCodes](int32 Index) { return MortonCodes[Index]; });
+    TArray<FLightLockCacheEntry> Sorted;
+    Sorted.Reserve(Order.Num());
+    for (int32 Index : Order)
+    {
+        Sorted.Add(Progress.Entries[Index]);
+    }
+
+    bool bWritten = FLightLockCore::WriteCacheFile(Settings.OutputPath, Settings.Environment, Sorted);
+    UnloadWorld(World);
+    if (!bWritten)
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Bake: Failed to write %s"), *Settings.OutputPath);
+        return 1;
+    }
+    IFileManager::Get().Delete(*ProgressPath, false, true, true);
+    UE_LOG(LogTemp, Display, TEXT("LightLock Bake: Wrote %d entries to %s"), Sorted.Num(), *Settings.OutputPath);
+    return 0;
+}
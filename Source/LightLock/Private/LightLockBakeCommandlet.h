@@ -0,0 +1,23 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LightLockBakeCommandlet.generated.h"
+
+// Pre-warms the static cache for a map. Samples static mesh surfaces, evaluates each sample with a registered
+// FLightLockBakeEvaluators callback on all cores and writes a Morton-ordered cache file.
+// UnrealEditor-Cmd <Project> -run=LightLockBake -Map=/Game/Maps/MyMap [-Spacing=50] [-Lightmap] [-Evaluator=SkyOcclusion]
+//     [-Rays=16] [-Precision=0.01] [-BatchSize=65536] [-TimeOfDayBucket=N] [-LightSetHash=N] [-Output=LightLock/cache.bin] [-Resume]
+// Lightmap mode hashes with HashLightmapSpace(GetTypeHash(Component->GetPathName()), LightmapUV, Component lightmap resolution).
+// Completed batches are appended to <Output>.progress; -Resume continues from it when the map and settings match.
+UCLASS()
+class ULightLockBakeCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    ULightLockBakeCommandlet();
+    virtual int32 Main(const FString& Params) override;
+};
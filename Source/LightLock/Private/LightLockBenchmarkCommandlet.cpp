@@ -0,0 +1,438 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockBenchmarkCommandlet.h"
+#include "LightLockCore.h"
+#include "LightLockReport.h"
+#include "Async/ParallelFor.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/App.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformMisc.h"
+#include "Math/RandomStream.h"
+
+namespace LightLockBenchmark
+{
+    using LightLockReport::FLatencySamples;
+
+    static constexpr float SURFACE_SPACING = 50.0f;
+    static constexpr int32 LATTICE_WIDTH = 1024;
+
+    struct FSettings
+    {
+        int32 Entries = 262144;
+        int32 Frames = 600;
+        int32 Threads = 0;
+        int32 Seed = 1337;
+    };
+
+    struct FResult
+    {
+        FString Name;
+        int64 Operations = 0;
+        double Seconds = 0.0;
+        TMap<FString, FLatencySamples> Latency;
+        FLightLockStats CoreStats;
+        SIZE_T MemoryBytes = 0;
+        TMap<FString, double> Extra;
+
+        TSharedRef<FJsonObject> ToJson()
+        {
+            int64 Entries = CoreStats.StaticCount + CoreStats.DynamicCount;
+            TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+            Json->SetStringField(TEXT("name"), Name);
+            Json->SetNumberField(TEXT("operations"), static_cast<double>(Operations));
+            Json->SetNumberField(TEXT("seconds"), Seconds);
+            Json->SetNumberField(TEXT("throughput_ops_per_sec"), Seconds > 0.0 ? Operations / Seconds : 0.0);
+            Json->SetNumberField(TEXT("hit_rate"), CoreStats.HitRate);
+            Json->SetNumberField(TEXT("queries"), static_cast<double>(CoreStats.TotalQueries));
+            Json->SetNumberField(TEXT("misses"), static_cast<double>(CoreStats.Misses));
+            Json->SetNumberField(TEXT("collisions"), static_cast<double>(CoreStats.Collisions));
+            Json->SetNumberField(TEXT("promotions"), static_cast<double>(CoreStats.Promotions));
+            Json->SetNumberField(TEXT("static_entries"), static_cast<double>(CoreStats.StaticCount));
+            Json->SetNumberField(TEXT("dynamic_entries"), static_cast<double>(CoreStats.DynamicCount));
+            Json->SetNumberField(TEXT("memory_bytes"), static_cast<double>(MemoryBytes));
+            Json->SetNumberField(TEXT("bytes_per_entry"), Entries > 0 ? static_cast<double>(MemoryBytes) / Entries : 0.0);
+
+            TSharedRef<FJsonObject> LatencyJson = MakeShared<FJsonObject>();
+            for (auto& Pair : Latency)
+            {
+                LatencyJson->SetObjectField(Pair.Key, Pair.Value.ToJson());
+            }
+            Json->SetObjectField(TEXT("latency"), LatencyJson);
+
+            TSharedRef<FJsonObject> ExtraJson = MakeShared<FJsonObject>();
+            for (const auto& Pair : Extra)
+            {
+                ExtraJson->SetNumberField(Pair.Key, Pair.Value);
+            }
+            Json->SetObjectField(TEXT("extra"), ExtraJson);
+            return Json;
+        }
+    };
+
+    static FLightLockConfig MakeConfig(const TCHAR* Name, int32 StaticCapacity, int32 DynamicCapacity)
+    {
+        FLightLockConfig Config;
+        Config.CachePath = FString::Printf(TEXT("LightLock/Benchmark/%s.bin"), Name);
+        Config.StaticCapacity = FMath::Max(StaticCapacity, 1);
+        Config.DynamicCapacity = FMath::Max(DynamicCapacity, 1);
+        Config.bEnableAsyncLoading = false;
+        return Config;
+    }
+
+    static FString GetCacheFile(const FLightLockConfig& Config)
+    {
+        return FPaths::ProjectSavedDir() / Config.CachePath;
+    }
+
+    static void DeleteCacheFile(const FLightLockConfig& Config)
+    {
+        IFileManager::Get().Delete(*GetCacheFile(Config), false, true, true);
+    }
+
+    static FVector SnapToSurface(const FVector& Point)
+    {
+        return FVector(FMath::GridSnap<FVector::FReal>(Point.X, SURFACE_SPACING), FMath::GridSnap<FVector::FReal>(Point.Y, SURFACE_SPACING), 0.0f);
+    }
+
+    static FVector PointForIndex(int32 Index)
+    {
+        return FVector((Index % LATTICE_WIDTH) * SURFACE_SPACING, (Index / LATTICE_WIDTH) * SURFACE_SPACING, 0.0f);
+    }
+
+    static FVector SurfaceNormal(const FVector& Point)
+    {
+        static const FVector Normals[] = { FVector::UpVector, FVector::ForwardVector, FVector::BackwardVector, FVector::RightVector, FVector::LeftVector };
+        return Normals[FLightLockHasher::HashWorldSpace(Point, FVector::UpVector, SURFACE_SPACING) % UE_ARRAY_COUNT(Normals)];
+    }
+
+    static FLinearColor SyntheticLighting(const FVector& Point, const FVector& Normal)
+    {
+        float Sky = FMath::Clamp(static_cast<float>(Normal.Z) * 0.5f + 0.5f, 0.0f, 1.0f);
+        float Pattern = 0.5f + 0.5f * FMath::Sin(Point.X * 0.001f) * FMath::Cos(Point.Y * 0.001f);
+        return FLinearColor(Sky * Pattern, Sky * 0.8f, 0.2f + 0.3f * Pattern, 1.0f);
+    }
+
+    static bool QueryOrStore(FLightLockCore& Core, const FLightLockConfig& Config, const FVector& Point, bool bIsStatic, FLatencySamples& QueryLatency)
+    {
+        FVector Normal = SurfaceNormal(Point);
+        uint32 Hash = FLightLockHasher::HashWorldSpace(Point, Normal, Config.WorldSpacePrecision);
+        FLinearColor Color;
+        float Weight;
+        uint64 StartCycles = FPlatformTime::Cycles64();
+        bool bHit = Core.Query(Hash, Point, Normal, Color, Weight);
+        QueryLatency.Add(FPlatformTime::Cycles64() - StartCycles);
+        if (!bHit)
+        {
+            Core.Store(Hash, SyntheticLighting(Point, Normal), 1.0f, Point, Normal, bIsStatic);
+        }
+        return bHit;
+    }
+
+    static void Populate(FLightLockCore& Core, const FLightLockConfig& Config, int32 Count)
+    {
+        for (int32 i = 0; i < Count; ++i)
+        {
+            FVector Point = PointForIndex(i);
+            FVector Normal = SurfaceNormal(Point);
+            uint32 Hash = FLightLockHasher::HashWorldSpace(Point, Normal, Config.WorldSpacePrecision);
+            Core.Store(Hash, SyntheticLighting(Point, Normal), 1.0f, Point, Normal, true);
+        }
+        Core.AdvanceFrame();
+    }
+
+    static void Collect(const FLightLockCore& Core, FResult& Result)
+    {
+        Result.CoreStats = Core.GetStats();
+        Result.MemoryBytes = Core.GetMemoryUsage();
+    }
+
+    // Camera flies a figure-eight over open terrain, revisiting parts of the path, querying surface points ahead of it.
+    static FResult RunFlythrough(const FSettings& Settings)
+    {
+        FResult Result;
+        Result.Name = TEXT("flythrough");
+        FLightLockConfig Config = MakeConfig(TEXT("flythrough"), Settings.Entries, Settings.Entries / 4);
+        DeleteCacheFile(Config);
+        {
+            FLightLockCore Core(Config);
+            FRandomStream Random(Settings.Seed);
+            FLatencySamples QueryLatency;
+            const int32 SamplesPerFrame = 2048;
+            const float ViewDistance = 5000.0f;
+            const float DeltaTime = 1.0f / 60.0f;
+
+            double StartTime = FPlatformTime::Seconds();
+            for (int32 Frame = 0; Frame < Settings.Frames; ++Frame)
+            {
+                float T = 2.0f * PI * Frame / Settings.Frames;
+                FVector Camera(FMath::Sin(T) * 20000.0f, FMath::Sin(2.0f * T) * 10000.0f, 500.0f);
+                FVector Forward = FVector(FMath::Cos(T), 2.0f * FMath::Cos(2.0f * T), 0.0f).GetSafeNormal();
+                FVector Right(Forward.Y, -Forward.X, 0.0f);
+                Core.UpdateCamera(Camera, Forward, 90.0f, ViewDistance, DeltaTime);
+                for (int32 i = 0; i < SamplesPerFrame; ++i)
+                {
+                    FVector Offset = Forward * Random.FRandRange(0.0f, ViewDistance) + Right * Random.FRandRange(-0.5f, 0.5f) * ViewDistance;
+                    QueryOrStore(Core, Config, SnapToSurface(Camera + Offset), Random.FRand() < 0.8f, QueryLatency);
+                }
+                if (Frame % 60 == 0)
+                {
+                    Core.CullDistantEntries(Camera, ViewDistance * 2.0f);
+                }
+                Core.AdvanceFrame();
+            }
+            Result.Seconds = FPlatformTime::Seconds() - StartTime;
+            Result.Operations = static_cast<int64>(Settings.Frames) * SamplesPerFrame;
+            Result.Latency.Add(TEXT("query"), MoveTemp(QueryLatency));
+            Collect(Core, Result);
+        }
+        DeleteCacheFile(Config);
+        return Result;
+    }
+
+    // Player walks a grid of rooms lit by dynamic entries while doors toggle and invalidate the lighting around them.
+    static FResult RunDoorToggles(const FSettings& Settings)
+    {
+        FResult Result;
+        Result.Name = TEXT("doors");
+        FLightLockConfig Config = MakeConfig(TEXT("doors"), Settings.Entries, Settings.Entries);
+        DeleteCacheFile(Config);
+        {
+            FLightLockCore Core(Config);
+            FRandomStream Random(Settings.Seed);
+            FLatencySamples QueryLatency;
+            FLatencySamples InvalidateLatency;
+            const int32 Rooms = 16;
+            const float RoomSize = 1000.0f;
+            const int32 SamplesPerFrame = 1024;
+            int64 Toggles = 0;
+
+            double StartTime = FPlatformTime::Seconds();
+            for (int32 Frame = 0; Frame < Settings.Frames; ++Frame)
+            {
+                int32 Room = (Frame / 40) % (Rooms * Rooms);
+                FVector RoomOrigin((Room % Rooms) * RoomSize, (Room / Rooms) * RoomSize, 0.0f);
+                for (int32 i = 0; i < SamplesPerFrame; ++i)
+                {
+                    FVector Point = RoomOrigin + FVector(Random.FRandRange(-RoomSize, 2.0f * RoomSize), Random.FRandRange(-RoomSize, 2.0f * RoomSize), 0.0f);
+                    QueryOrStore(Core, Config, SnapToSurface(Point), false, QueryLatency);
+                }
+                if (Frame % 30 == 0)
+                {
+                    FVector Door = RoomOrigin + FVector(RoomSize, RoomSize * 0.5f, 0.0f);
+                    uint64 StartCycles = FPlatformTime::Cycles64();
+                    Core.InvalidateSphere(Door, 400.0f);
+                    InvalidateLatency.Add(FPlatformTime::Cycles64() - StartCycles);
+                    ++Toggles;
+                }
+                Core.AdvanceFrame();
+            }
+            Result.Seconds = FPlatformTime::Seconds() - StartTime;
+            Result.Operations = static_cast<int64>(Settings.Frames) * SamplesPerFrame;
+            Result.Latency.Add(TEXT("query"), MoveTemp(QueryLatency));
+            Result.Latency.Add(TEXT("invalidate"), MoveTemp(InvalidateLatency));
+            Result.Extra.Add(TEXT("door_toggles"), static_cast<double>(Toggles));
+            Collect(Core, Result);
+        }
+        DeleteCacheFile(Config);
+        return Result;
+    }
+
+    // Unique static stores into a small cache so that nearly every store has to evict.
+    static FResult RunChurn(const FSettings& Settings)
+    {
+        FResult Result;
+        Result.Name = TEXT("churn");
+        int32 Capacity = FMath::Max(Settings.Entries / 64, 1024);
+        FLightLockConfig Config = MakeConfig(TEXT("churn"), Capacity, Capacity);
+        DeleteCacheFile(Config);
+        {
+            FLightLockCore Core(Config);
+            FRandomStream Random(Settings.Seed);
+            FLatencySamples StoreLatency;
+            const int32 Stores = FMath::Max(Settings.Entries / 4, Capacity * 2);
+
+            double StartTime = FPlatformTime::Seconds();
+            for (int32 i = 0; i < Stores; ++i)
+            {
+                FVector Point = PointForIndex(i);
+                FVector Normal = SurfaceNormal(Point);
+                uint32 Hash = FLightLockHasher::HashWorldSpace(Point, Normal, Config.WorldSpacePrecision);
+                uint64 StartCycles = FPlatformTime::Cycles64();
+                Core.Store(Hash, SyntheticLighting(Point, Normal), 1.0f, Point, Normal, true, 1, Random.FRandRange(0.1f, 1.0f));
+                StoreLatency.Add(FPlatformTime::Cycles64() - StartCycles);
+                if (i % 4096 == 0)
+                {
+                    Core.AdvanceFrame();
+                }
+            }
+            Result.Seconds = FPlatformTime::Seconds() - StartTime;
+            Result.Operations = Stores;
+            Result.Latency.Add(TEXT("store"), MoveTemp(StoreLatency));
+            Result.Extra.Add(TEXT("capacity"), Capacity);
+            Collect(Core, Result);
+        }
+        DeleteCacheFile(Config);
+        return Result;
+    }
+
+    // Writes a full cache file, then measures a synchronous cold start from it.
+    static FResult RunColdLoad(const FSettings& Settings)
+    {
+        FResult Result;
+        Result.Name = TEXT("coldload");
+        FLightLockConfig Config = MakeConfig(TEXT("coldload"), Settings.Entries, Settings.Entries / 4);
+        DeleteCacheFile(Config);
+        double SaveStart = 0.0;
+        {
+            FLightLockCore Writer(Config);
+            Populate(Writer, Config, Settings.Entries);
+            SaveStart = FPlatformTime::Seconds();
+            Writer.Flush();
+            Result.Extra.Add(TEXT("save_seconds"), FPlatformTime::Seconds() - SaveStart);
+        }
+        // Flush only snapshots; the destructor waits for the background write to land.
+        Result.Extra.Add(TEXT("write_seconds"), FPlatformTime::Seconds() - SaveStart);
+        Result.Extra.Add(TEXT("file_bytes"), static_cast<double>(IFileManager::Get().FileSize(*GetCacheFile(Config))));
+        {
+            double StartTime = FPlatformTime::Seconds();
+            FLightLockCore Core(Config);
+            Result.Seconds = FPlatformTime::Seconds() - StartTime;
+            Collect(Core, Result);
+            Result.Operations = Result.CoreStats.StaticCount;
+        }
+        DeleteCacheFile(Config);
+        return Result;
+    }
+
+    // All worker threads hammer a fully populated cache with queries, about 10% of them misses.
+    static FResult RunQueryStorm(const FSettings& Settings)
+    {
+        FResult Result;
+        Result.Name = TEXT("storm");
+        FLightLockConfig Config = MakeConfig(TEXT("storm"), Settings.Entries, Settings.Entries / 4);
+        DeleteCacheFile(Config);
+        {
+            FLightLockCore Core(Config);
+            Populate(Core, Config, Settings.Entries);
+            Core.ResetStats();
+
+            int32 NumThreads = Settings.Threads > 0 ? Settings.Threads : FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+            int32 QueriesPerThread = Settings.Entries;
+            TArray<FLatencySamples> PerThread;
+            PerThread.SetNum(NumThreads);
+
+            double StartTime = FPlatformTime::Seconds();
+            ParallelFor(NumThreads, [&](int32 ThreadIndex)
+            {
+                FRandomStream Random(Settings.Seed + ThreadIndex);
+                FLatencySamples& Samples = PerThread[ThreadIndex];
+                Samples.Nanoseconds.Reserve(QueriesPerThread);
+                int32 MissRange = Settings.Entries + Settings.Entries / 9;
+                for (int32 i = 0; i < QueriesPerThread; ++i)
+                {
+                    FVector Point = PointForIndex(Random.RandHelper(MissRange));
+                    FVector Normal = SurfaceNormal(Point);
+                    uint32 Hash = FLightLockHasher::HashWorldSpace(Point, Normal, Config.WorldSpacePrecision);
+                    FLinearColor Color;
+                    float Weight;
+                    uint64 StartCycles = FPlatformTime::Cycles64();
+                    Core.Query(Hash, Point, Normal, Color, Weight);
+                    Samples.Add(FPlatformTime::Cycles64() - StartCycles);
+                }
+            });
+            Result.Seconds = FPlatformTime::Seconds() - StartTime;
+            Result.Operations = static_cast<int64>(NumThreads) * QueriesPerThread;
+
+            FLatencySamples QueryLatency;
+            for (const FLatencySamples& Samples : PerThread)
+            {
+                QueryLatency.Nanoseconds.Append(Samples.Nanoseconds);
+            }
+            Result.Latency.Add(TEXT("query"), MoveTemp(QueryLatency));
+            Result.Extra.Add(TEXT("threads"), NumThreads);
+            Collect(Core, Result);
+        }
+        DeleteCacheFile(Config);
+        return Result;
+    }
+}
+
+ULightLockBenchmarkCommandlet::ULightLockBenchmarkCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 ULightLockBenchmarkCommandlet::Main(const FString& Params)
+{
+    using namespace LightLockBenchmark;
+
+    FSettings Settings;
+    FParse::Value(*Params, TEXT("Entries="), Settings.Entries);
+    FParse::Value(*Params, TEXT("Frames="), Settings.Frames);
+    FParse::Value(*Params, TEXT("Threads="), Settings.Threads);
+    FParse::Value(*Params, TEXT("Seed="), Settings.Seed);
+    Settings.Entries = FMath::Max(Settings.Entries, 1024);
+    Settings.Frames = FMath::Max(Settings.Frames, 1);
+
+    FString WorkloadList = TEXT("flythrough,doors,churn,coldload,storm");
+    FParse::Value(*Params, TEXT("Workloads="), WorkloadList, false);
+    FString OutputPath = FPaths::ProjectSavedDir() / TEXT("LightLock/Benchmark.json");
+    FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+    TArray<FString> Workloads;
+    WorkloadList.ParseIntoArray(Workloads, TEXT(","));
+
+    TArray<TSharedPtr<FJsonValue>> Results;
+    for (const FString& Workload : Workloads)
+    {
+        FResult Result;
+        if (Workload == TEXT("flythrough")) Result = RunFlythrough(Settings);
+        else if (Workload == TEXT("doors")) Result = RunDoorToggles(Settings);
+        else if (Workload == TEXT("churn")) Result = RunChurn(Settings);
+        else if (Workload == TEXT("coldload")) Result = RunColdLoad(Settings);
+        else if (Workload == TEXT("storm")) Result = RunQueryStorm(Settings);
+        else
+        {
+            UE_LOG(LogTemp, Error, TEXT("LightLock Benchmark: Unknown workload '%s'"), *Workload);
+            return 1;
+        }
+        UE_LOG(LogTemp, Display, TEXT("LightLock Benchmark: %s - %lld ops in %.3fs, hit rate %.1f%%"),
+            *Result.Name, Result.Operations, Result.Seconds, Result.CoreStats.HitRate * 100.0f);
+        Results.Add(MakeShared<FJsonValueObject>(Result.ToJson()));
+    }
+
+    TSharedRef<FJsonObject> SettingsJson = MakeShared<FJsonObject>();
+    SettingsJson->SetNumberField(TEXT("entries"), Settings.Entries);
+    SettingsJson->SetNumberField(TEXT("frames"), Settings.Frames);
+    SettingsJson->SetNumberField(TEXT("threads"), Settings.Threads);
+    SettingsJson->SetNumberField(TEXT("seed"), Settings.Seed);
+
+    TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+    Report->SetStringField(TEXT("benchmark"), TEXT("LightLock"));
+    Report->SetNumberField(TEXT("format_version"), 1);
+    Report->SetStringField(TEXT("platform"), FString(FPlatformProperties::IniPlatformName()));
+    Report->SetStringField(TEXT("build_configuration"), LexToString(FApp::GetBuildConfiguration()));
+    Report->SetNumberField(TEXT("logical_cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+    Report->SetObjectField(TEXT("settings"), SettingsJson);
+    Report->SetArrayField(TEXT("workloads"), Results);
+
+    FString Output;
+    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+    FJsonSerializer::Serialize(Report, Writer);
+    if (!FFileHelper::SaveStringToFile(Output, *OutputPath))
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Benchmark: Failed to write %s"), *OutputPath);
+        return 1;
+    }
+    UE_LOG(LogTemp, Display, TEXT("LightLock Benchmark: Wrote %s"), *OutputPath);
+    return 0;
+}
@@ -0,0 +1,20 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LightLockBenchmarkCommandlet.generated.h"
+
+// Headless synthetic benchmarks for FLightLockCore.
+// UnrealEditor-Cmd <Project> -run=LightLockBenchmark -nullrhi [-Workloads=flythrough,doors,churn,coldload,storm]
+//     [-Entries=N] [-Frames=N] [-Threads=N] [-Seed=N] [-Output=<path.json>]
+UCLASS()
+class ULightLockBenchmarkCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    ULightLockBenchmarkCommandlet();
+    virtual int32 Main(const FString& Params) override;
+};
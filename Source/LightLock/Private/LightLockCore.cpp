@@ -1,14 +1,107 @@
 // Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
 
 #include "LightLockCore.h"
+#include "LightLockTrace.h"
+#include "LightLockMemoryGovernor.h"
+#include "LightLockSharedCache.h"
+#include "LightLockAdmission.h"
+#include "LightLockDelta.h"
+#include "Misc/CoreDelegates.h"
 #include "Misc/Paths.h"
 #include "HAL/PlatformFilemanager.h"
 #include "GenericPlatform/GenericPlatformFile.h"
 #include "Serialization/Archive.h"
 #include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+#include "Algo/StableSort.h"
+#include "Algo/BinarySearch.h"
+#include <algorithm>
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DECLARE_STATS_GROUP(TEXT("LightLock"), STATGROUP_LightLock, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Query"), STAT_LightLock_Query, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Query Batch"), STAT_LightLock_QueryBatch, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Store"), STAT_LightLock_Store, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Drain Store Queue"), STAT_LightLock_DrainStoreQueue, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Evict"), STAT_LightLock_Evict, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Invalidate Region"), STAT_LightLock_InvalidateRegion, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Cull Distant Entries"), STAT_LightLock_CullDistantEntries, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Save"), STAT_LightLock_Save, STATGROUP_LightLock);
+DECLARE_CYCLE_STAT(TEXT("Load"), STAT_LightLock_Load, STATGROUP_LightLock);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Static Entries"), STAT_LightLock_StaticEntries, STATGROUP_LightLock);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dynamic Entries"), STAT_LightLock_DynamicEntries, STATGROUP_LightLock);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Hit Rate"), STAT_LightLock_HitRate, STATGROUP_LightLock);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Query P99 (us)"), STAT_LightLock_QueryP99, STATGROUP_LightLock);
+
+CSV_DEFINE_CATEGORY(LightLock, true);
+
+#if LIGHTLOCK_ENABLE_INSTRUMENTATION
+#define LIGHTLOCK_SCOPE_OP(Name, Op) \
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_##Name); \
+    SCOPE_CYCLE_COUNTER(STAT_LightLock_##Name); \
+    ScopedLatency ANONYMOUS_VARIABLE(LightLockLatency)(*this, Op)
+#define LIGHTLOCK_SCOPE_LOCK(Mutex, Op) TimedScopeLock ANONYMOUS_VARIABLE(LightLockLock)(*this, &Mutex, Op)
+#else
+#define LIGHTLOCK_SCOPE_OP(Name, Op)
+#define LIGHTLOCK_SCOPE_LOCK(Mutex, Op) FScopeLock ANONYMOUS_VARIABLE(LightLockLock)(&Mutex)
+#endif
 
 static constexpr uint32 LIGHTLOCK_MAGIC = 0x4C4C434B;
-static constexpr uint32 LIGHTLOCK_VERSION = 4;
+static constexpr uint32 LIGHTLOCK_VERSION = 7;
+static constexpr uint32 LIGHTLOCK_VERSION_NO_HINTS = 6;
+static constexpr uint32 LIGHTLOCK_VERSION_NO_TILES = 5;
+static constexpr uint32 LIGHTLOCK_VERSION_NO_ENVIRONMENT = 4;
+
+// Cache file header. v4 files predate environment keys and read as the default environment;
+// v5 files have no tile directory after the entries and v6 files no load hints after that.
+static bool SerializeCacheHeader(FArchive& Ar, uint32& Version, FLightLockEnvironmentKey& Environment, uint32& Count)
+{
+    uint32 Magic = LIGHTLOCK_MAGIC;
+    if (Ar.IsSaving()) Version = LIGHTLOCK_VERSION;
+    Ar << Magic << Version;
+    if (Magic != LIGHTLOCK_MAGIC) return false;
+    if (Version == LIGHTLOCK_VERSION || Version == LIGHTLOCK_VERSION_NO_HINTS || Version == LIGHTLOCK_VERSION_NO_TILES)
+    {
+        Ar << Environment.TimeOfDayBucket << Environment.LightSetHash;
+    }
+    else if (Version == LIGHTLOCK_VERSION_NO_ENVIRONMENT)
+    {
+        Environment = FLightLockEnvironmentKey();
+    }
+    else
+    {
+        return false;
+    }
+    Ar << Count;
+    return !Ar.IsError();
+}
+
+static void SerializeCacheEntry(FArchive& Ar, uint32& Hash, FLightPath& Path)
+{
+    Ar << Hash;
+    Ar << Path.Color.R << Path.Color.G << Path.Color.B << Path.Color.A;
+    Ar << Path.Weight << Path.BounceCount << Path.Flags << Path.Confidence;
+    Ar << Path.PositionValidation.X << Path.PositionValidation.Y << Path.PositionValidation.Z;
+    Ar << Path.NormalValidation.X << Path.NormalValidation.Y << Path.NormalValidation.Z;
+    Ar << Path.IncidentDirection.X << Path.IncidentDirection.Y << Path.IncidentDirection.Z;
+    Ar << Path.Roughness;
+}
+
+// Each thread is pinned to one stat shard on first use, so counter updates stay on a core-local cache line.
+static std::atomic<uint32> GLightLockNextStatShard{0};
+static thread_local uint32 GLightLockStatShard = MAX_uint32;
+
+static uint32 GetThreadStatShard()
+{
+    if (GLightLockStatShard == MAX_uint32)
+    {
+        GLightLockStatShard = GLightLockNextStatShard.fetch_add(1, std::memory_order_relaxed);
+    }
+    return GLightLockStatShard;
+}
 
 FLightPath::FLightPath()
     : Color(FLinearColor::Black)
@@ -47,9 +140,389 @@ bool FLightPath::ValidateNormal(const FVector& Normal) const
     return FMath::Abs(NormalValidation.X - Quantized.X) <= 10 && FMath::Abs(NormalValidation.Y - Quantized.Y) <= 10 && FMath::Abs(NormalValidation.Z - Quantized.Z) <= 10;
 }
 
+FLightLockStaticTable::FLightLockStaticTable()
+    : Delta(0, std::hash<uint32>(), std::equal_to<uint32>(), DeltaMap::allocator_type(&DeltaArenas[0]))
+    , Frozen(0, std::hash<uint32>(), std::equal_to<uint32>(), DeltaMap::allocator_type(&DeltaArenas[1]))
+{
+}
+
+FLightLockStaticTable::~FLightLockStaticTable()
+{
+    // The builder reads Frozen, so it must finish before the table goes away.
+    if (PendingBase.IsValid()) PendingBase.Wait();
+}
+
+uint64 FLightLockStaticTable::GetMortonCode(const FLightPath& Path)
+{
+    // PositionValidation is the position at 10-unit resolution; key on the same 1m cells as the bake output.
+    const FIntVector& Cell = Path.PositionValidation;
+    return FLightLockHasher::MortonCode(FVector(Cell.X, Cell.Y, Cell.Z) * 10.0f);
+}
+
+int32 FLightLockStaticTable::FBase::Find(uint32 Hash) const
+{
+    if (Index.Num() == 0) return INDEX_NONE;
+    for (uint32 Slot = (Hash * 0x9E3779B1u) >> IndexShift; ; Slot = (Slot + 1) & IndexMask)
+    {
+        uint32 Entry = Index[Slot];
+        if (Entry == 0) return INDEX_NONE;
+        if (Hashes[Entry - 1] == Hash) return static_cast<int32>(Entry - 1);
+    }
+}
+
+void FLightLockStaticTable::FBase::BuildIndex()
+{
+    uint32 Bits = FMath::Max<uint32>(FMath::CeilLogTwo(static_cast<uint32>(Hashes.Num()) * 2), 1);
+    Index.Reset();
+    Index.SetNumZeroed(1 << Bits);
+    IndexMask = (1u << Bits) - 1;
+    IndexShift = 32 - Bits;
+    for (int32 i = 0; i < Hashes.Num(); ++i)
+    {
+        uint32 Slot = (Hashes[i] * 0x9E3779B1u) >> IndexShift;
+        while (Index[Slot] != 0)
+        {
+            Slot = (Slot + 1) & IndexMask;
+        }
+        Index[Slot] = static_cast<uint32>(i + 1);
+    }
+}
+
+const FLightPath* FLightLockStaticTable::Find(uint32 Hash) const
+{
+    int32 BaseIndex = Base.IsValid() ? Base->Find(Hash) : INDEX_NONE;
+    if (BaseIndex != INDEX_NONE && !BaseRemoved[BaseIndex])
+    {
+        return &Base->Paths[BaseIndex];
+    }
+    auto It = Delta.find(Hash);
+    if (It != Delta.end()) return &It->second;
+    if (Frozen.empty()) return nullptr;
+    It = Frozen.find(Hash);
+    return It != Frozen.end() && IsLiveFrozen(Hash) ? &It->second : nullptr;
+}
+
+void FLightLockStaticTable::Add(uint32 Hash, const FLightPath& Path)
+{
+    int32 BaseIndex = Base.IsValid() ? Base->Find(Hash) : INDEX_NONE;
+    if (BaseIndex != INDEX_NONE && !BaseRemoved[BaseIndex])
+    {
+        if (Base.IsUnique() && !IsCompacting())
+        {
+            Base->Paths[BaseIndex] = Path;
+            return;
+        }
+        // A snapshot or the compactor is reading the base; shadow the entry in the delta instead of writing under it.
+        // (A write under a finished build would also be lost when its result is swapped in.)
+        BaseRemoved[BaseIndex] = true;
+        NumRemoved++;
+        // The build still copies the old entry; a later Remove() that only erases the delta must not revive it.
+        if (IsCompacting()) Journal.Add(Hash);
+    }
+    else if (!Frozen.empty() && Frozen.find(Hash) != Frozen.end() && IsLiveFrozen(Hash))
+    {
+        Journal.Add(Hash);
+        NumFrozenRemoved++;
+    }
+    Delta[Hash] = Path;
+    // Compacting once the delta is a fixed fraction of the base keeps stores amortized O(1).
+    if (!IsCompacting() && NeedsCompaction())
+    {
+        StartCompaction();
+    }
+}
+
+bool FLightLockStaticTable::Remove(uint32 Hash)
+{
+    if (Delta.erase(Hash) > 0) return true;
+    int32 BaseIndex = Base.IsValid() ? Base->Find(Hash) : INDEX_NONE;
+    if (BaseIndex != INDEX_NONE && !BaseRemoved[BaseIndex])
+    {
+        BaseRemoved[BaseIndex] = true;
+        NumRemoved++;
+        // The new base is built from the old one, so the removal has to be replayed onto it.
+        if (IsCompacting()) Journal.Add(Hash);
+        else if (NeedsCompaction()) StartCompaction();
+        return true;
+    }
+    if (!Frozen.empty() && Frozen.find(Hash) != Frozen.end() && IsLiveFrozen(Hash))
+    {
+        Journal.Add(Hash);
+        NumFrozenRemoved++;
+        return true;
+    }
+    return false;
+}
+
+void FLightLockStaticTable::Reset()
+{
+    if (PendingBase.IsValid())
+    {
+        PendingBase.Wait();
+        PendingBase = TSharedFuture<TSharedPtr<FBase>>();
+    }
+    Base.Reset();
+    BaseRemoved.Empty();
+    NumRemoved = 0;
+    Journal.Reset();
+    NumFrozenRemoved = 0;
+    DeltaArenas[DeltaArenaIndex ^ 1].Reset();
+    new (&Frozen) DeltaMap(0, std::hash<uint32>(), std::equal_to<uint32>(), DeltaMap::allocator_type(&DeltaArenas[DeltaArenaIndex ^ 1]));
+    ResetDelta();
+}
+
+bool FLightLockStaticTable::NeedsCompaction() const
+{
+    int32 Threshold = FMath::Max(MIN_COMPACT_DELTA, GetBaseNum() / 4);
+    return static_cast<int32>(Delta.size()) > Threshold || NumRemoved > Threshold;
+}
+
+void FLightLockStaticTable::Compact()
+{
+    if (IsCompacting()) FinishCompaction();
+    if (Delta.empty() && NumRemoved == 0) return;
+    StartCompaction();
+    FinishCompaction();
+}
+
+void FLightLockStaticTable::Tick()
+{
+    if (PendingBase.IsValid() && PendingBase.IsReady())
+    {
+        FinishCompaction();
+    }
+    // Add() only starts a compaction when none is running; catch up on a delta that grew meanwhile.
+    if (!IsCompacting() && NeedsCompaction())
+    {
+        StartCompaction();
+    }
+}
+
+void FLightLockStaticTable::StartCompaction()
+{
+    check(!IsCompacting());
+    // Hand the delta to the builder as Frozen and continue in a fresh delta on the other arena.
+    // Frozen is empty and its arena already reset, so it is abandoned rather than destroyed.
+    new (&Frozen) DeltaMap(MoveTemp(Delta));
+    DeltaArenaIndex ^= 1;
+    ResetDelta();
+    
+    TSharedPtr<const FBase> OldBase = Base;
+    // Shared so that snapshots can wait for the build too.
+    PendingBase = Async(EAsyncExecution::ThreadPool, [OldBase, Removed = BaseRemoved, Source = &Frozen]()
+    {
+        TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_CompactStatic);
+        return BuildBase(OldBase.Get(), Removed, *Source);
+    }).Share();
+}
+
+void FLightLockStaticTable::FinishCompaction()
+{
+    PendingBase.Wait();
+    TSharedPtr<FBase> NewBase = PendingBase.Get();
+    PendingBase = TSharedFuture<TSharedPtr<FBase>>();
+    
+    // Snapshots holding the old base keep it alive until they finish.
+    Base = NewBase;
+    BaseRemoved.Init(false, GetBaseNum());
+    NumRemoved = 0;
+    // The new base still has entries removed or overwritten while it was built; tombstone them again.
+    auto Shadow = [this](uint32 Hash)
+    {
+        int32 BaseIndex = Base->Find(Hash);
+        if (BaseIndex != INDEX_NONE && !BaseRemoved[BaseIndex])
+        {
+            BaseRemoved[BaseIndex] = true;
+            NumRemoved++;
+        }
+    };
+    for (uint32 Hash : Journal)
+    {
+        Shadow(Hash);
+    }
+    for (const auto& Pair : Delta)
+    {
+        Shadow(Pair.first);
+    }
+    Journal.Reset();
+    NumFrozenRemoved = 0;
+    DeltaArenas[DeltaArenaIndex ^ 1].Reset();
+    new (&Frozen) DeltaMap(0, std::hash<uint32>(), std::equal_to<uint32>(), DeltaMap::allocator_type(&DeltaArenas[DeltaArenaIndex ^ 1]));
+}
+
+TSharedPtr<FLightLockStaticTable::FBase> FLightLockStaticTable::BuildBase(const FBase* OldBase, const TBitArray<>& Removed, const DeltaMap& Source)
+{
+    int32 NewNum = (OldBase ? OldBase->Hashes.Num() : 0) - Removed.CountSetBits() + static_cast<int32>(Source.size());
+    TSharedPtr<FBase> NewBase = MakeShared<FBase>();
+    TArray<uint64> Codes;
+    TArray<uint32> Hashes;
+    TArray<FLightPath> Paths;
+    Codes.Reserve(NewNum);
+    Hashes.Reserve(NewNum);
+    Paths.Reserve(NewNum);
+    bool bSorted = true;
+    auto Collect = [&](uint32 Hash, const FLightPath& Path)
+    {
+        uint64 Code = GetMortonCode(Path);
+        bSorted &= Codes.Num() == 0 || Codes.Last() <= Code;
+        Codes.Add(Code);
+        Hashes.Add(Hash);
+        Paths.Add(Path);
+    };
+    TArray<FDeltaRef> DeltaOrder;
+    DeltaOrder.Reserve(Source.size());
+    for (const auto& Pair : Source)
+    {
+        DeltaOrder.Add({ GetMortonCode(Pair.second), Pair.first, &Pair.second });
+    }
+    ForEachMerged(OldBase, Removed, DeltaOrder, Collect);
+    NewNum = Codes.Num();
+    
+    if (!bSorted)
+    {
+        // Only reachable when in-place overwrites moved an entry across a cell boundary.
+        TArray<int32> Order;
+        Order.SetNumUninitialized(NewNum);
+        for (int32 i = 0; i < NewNum; ++i) Order[i] = i;
+        Algo::StableSortBy(Order, [&Codes](int32 i) { return Codes[i]; });
+        NewBase->Codes.Reserve(NewNum);
+        NewBase->Hashes.Reserve(NewNum);
+        NewBase->Paths.Reserve(NewNum);
+        for (int32 i : Order)
+        {
+            NewBase->Codes.Add(Codes[i]);
+            NewBase->Hashes.Add(Hashes[i]);
+            NewBase->Paths.Add(Paths[i]);
+        }
+    }
+    else
+    {
+        NewBase->Codes = MoveTemp(Codes);
+        NewBase->Hashes = MoveTemp(Hashes);
+        NewBase->Paths = MoveTemp(Paths);
+    }
+    NewBase->BuildIndex();
+    return NewBase;
+}
+
+FLightLockStaticTable::FSnapshot FLightLockStaticTable::Snapshot()
+{
+    FSnapshot Result;
+    if (!IsCompacting())
+    {
+        if (Delta.empty() && NumRemoved == 0)
+        {
+            Result.Base = Base;
+            return Result;
+        }
+        // Fold the changes into a new base and share that rather than copying them; starting is O(1).
+        StartCompaction();
+        Result.PendingBase = PendingBase;
+        return Result;
+    }
+    // The running build covers everything up to its start; copy only what changed since.
+    Result.PendingBase = PendingBase;
+    Result.Shadowed = Journal.Array();
+    Result.Delta.Reserve(Delta.size());
+    for (const auto& Pair : Delta)
+    {
+        FLightLockCacheEntry& Entry = Result.Delta.AddDefaulted_GetRef();
+        Entry.Hash = Pair.first;
+        Entry.Path = Pair.second;
+    }
+    return Result;
+}
+
+const FLightLockStaticTable::FBase* FLightLockStaticTable::FSnapshot::Resolve(TBitArray<>& OutRemoved) const
+{
+    const FBase* SnapshotBase = PendingBase.IsValid() ? PendingBase.Get().Get() : Base.Get();
+    OutRemoved.Init(false, SnapshotBase ? SnapshotBase->Hashes.Num() : 0);
+    if (!SnapshotBase) return nullptr;
+    // Same shadowing as FinishCompaction, applied to this view only.
+    auto Shadow = [SnapshotBase, &OutRemoved](uint32 Hash)
+    {
+        int32 BaseIndex = SnapshotBase->Find(Hash);
+        if (BaseIndex != INDEX_NONE) OutRemoved[BaseIndex] = true;
+    };
+    for (uint32 Hash : Shadowed)
+    {
+        Shadow(Hash);
+    }
+    for (const FLightLockCacheEntry& Entry : Delta)
+    {
+        Shadow(Entry.Hash);
+    }
+    return SnapshotBase;
+}
+
+void FLightLockStaticTable::ForEachSample(int32 NumSamples, FRandomStream& Random, TFunctionRef<void(uint32 Hash, const FLightPath& Path)> Func) const
+{
+    const int32 BaseNum = GetBaseNum();
+    const int32 DeltaNum = static_cast<int32>(Delta.size());
+    const int32 Total = BaseNum + DeltaNum + static_cast<int32>(Frozen.size());
+    if (Total == 0) return;
+    // The maps have no random access by position, but a bucket does; probe a few buckets from a random one.
+    auto SampleMap = [&Random, &Func](const DeltaMap& Map, auto&& IsLive)
+    {
+        const size_t BucketCount = Map.bucket_count();
+        size_t Bucket = Random.GetUnsignedInt() % BucketCount;
+        for (int32 Probe = 0; Probe < 8; ++Probe, Bucket = (Bucket + 1) % BucketCount)
+        {
+            if (Map.bucket_size(Bucket) == 0) continue;
+            auto It = Map.begin(Bucket);
+            if (IsLive(It->first)) Func(It->first, It->second);
+            return;
+        }
+    };
+    // Each sample picks a source in proportion to its size; tombstoned picks are skipped rather than redrawn.
+    for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+    {
+        int32 Pick = Random.RandHelper(Total);
+        if (Pick < BaseNum)
+        {
+            if (!BaseRemoved[Pick]) Func(Base->Hashes[Pick], Base->Paths[Pick]);
+        }
+        else if (Pick < BaseNum + DeltaNum)
+        {
+            SampleMap(Delta, [](uint32) { return true; });
+        }
+        else
+        {
+            SampleMap(Frozen, [this](uint32 Hash) { return IsLiveFrozen(Hash); });
+        }
+    }
+}
+
+int32 FLightLockStaticTable::FSnapshot::Num() const
+{
+    TBitArray<> Removed;
+    const FBase* SnapshotBase = Resolve(Removed);
+    int32 BaseNum = SnapshotBase ? SnapshotBase->Hashes.Num() : 0;
+    return BaseNum - Removed.CountSetBits() + Delta.Num();
+}
+
+void FLightLockStaticTable::ResetDelta()
+{
+    // The map's memory is owned by the arena, so drop both in O(1) and rebuild an empty map in place.
+    FLightLockArena& Arena = DeltaArenas[DeltaArenaIndex];
+    Arena.Reset();
+    new (&Delta) DeltaMap(0, std::hash<uint32>(), std::equal_to<uint32>(), DeltaMap::allocator_type(&Arena));
+}
+
+SIZE_T FLightLockStaticTable::GetAllocatedBytes() const
+{
+    SIZE_T Bytes = BaseRemoved.GetAllocatedSize() + DeltaArenas[0].GetAllocatedBytes() + DeltaArenas[1].GetAllocatedBytes() + Journal.GetAllocatedSize();
+    if (Base.IsValid())
+    {
+        Bytes += Base->Codes.GetAllocatedSize() + Base->Hashes.GetAllocatedSize() + Base->Paths.GetAllocatedSize() + Base->Index.GetAllocatedSize();
+    }
+    return Bytes;
+}
+
 FSpatialGrid::FSpatialGrid()
+    : Arena(64 * 1024)
+    , Grid(1024, std::hash<uint64>(), std::equal_to<uint64>(), CellMap::allocator_type(&Arena))
 {
-    Grid.reserve(1024);
 }
 
 FSpatialGrid::~FSpatialGrid()
@@ -73,7 +546,15 @@ void FSpatialGrid::Insert(const FVector& Position, uint32 Hash)
 {
     FScopeLock Lock(&Mutex);
     uint64 Key = GetCellKey(Position);
-    Grid[Key].Add(Hash);
+    CellBucket& Bucket = Grid[Key];
+    if (Bucket.Head == nullptr || Bucket.Head->Count == CELL_CHUNK_CAPACITY)
+    {
+        CellChunk* Chunk = static_cast<CellChunk*>(Arena.Allocate(sizeof(CellChunk), alignof(CellChunk)));
+        Chunk->Next = Bucket.Head;
+        Chunk->Count = 0;
+        Bucket.Head = Chunk;
+    }
+    Bucket.Head->Hashes[Bucket.Head->Count++] = Hash;
 }
 
 void FSpatialGrid::Remove(const FVector& Position, uint32 Hash)
@@ -81,21 +562,35 @@ void FSpatialGrid::Remove(const FVector& Position, uint32 Hash)
     FScopeLock Lock(&Mutex);
     uint64 Key = GetCellKey(Position);
     auto It = Grid.find(Key);
-    if (It != Grid.end())
+    if (It == Grid.end()) return;
+    
+    // Only the head chunk is ever partially filled, so backfill the hole from its last slot.
+    CellBucket& Bucket = It->second;
+    for (CellChunk* Chunk = Bucket.Head; Chunk; Chunk = Chunk->Next)
     {
-        It->second.Remove(Hash);
-        if (It->second.Num() == 0)
+        for (uint32 i = 0; i < Chunk->Count; ++i)
         {
-            Grid.erase(It);
+            if (Chunk->Hashes[i] != Hash) continue;
+            CellChunk* Head = Bucket.Head;
+            Chunk->Hashes[i] = Head->Hashes[--Head->Count];
+            if (Head->Count == 0)
+            {
+                Bucket.Head = Head->Next;
+                Arena.Free(Head, sizeof(CellChunk));
+            }
+            if (Bucket.Head == nullptr)
+            {
+                Grid.erase(It);
+            }
+            return;
         }
     }
 }
 
-TArray<uint32> FSpatialGrid::QueryRegion(const FBox& Region) const
+template<typename ArrayType>
+void FSpatialGrid::CollectRegion(const FBox& Region, ArrayType& OutHashes) const
 {
     FScopeLock Lock(&Mutex);
-    TArray<uint32> Result;
-    Result.Reserve(256);
     int32 MinX = FMath::FloorToInt(Region.Min.X / CELL_SIZE);
     int32 MaxX = FMath::FloorToInt(Region.Max.X / CELL_SIZE);
     int32 MinY = FMath::FloorToInt(Region.Min.Y / CELL_SIZE);
@@ -113,29 +608,41 @@ TArray<uint32> FSpatialGrid::QueryRegion(const FBox& Region) const
                 auto It = Grid.find(Key);
                 if (It != Grid.end())
                 {
-                    Result.Append(It->second);
+                    for (const CellChunk* Chunk = It->second.Head; Chunk; Chunk = Chunk->Next)
+                    {
+                        OutHashes.Append(Chunk->Hashes, Chunk->Count);
+                    }
                 }
             }
         }
     }
+}
+
+TArray<uint32> FSpatialGrid::QueryRegion(const FBox& Region) const
+{
+    TArray<uint32> Result;
+    Result.Reserve(256);
+    CollectRegion(Region, Result);
     return Result;
 }
 
+void FSpatialGrid::QueryRegion(const FBox& Region, TArray<uint32, TMemStackAllocator<>>& OutHashes) const
+{
+    CollectRegion(Region, OutHashes);
+}
+
 void FSpatialGrid::Clear()
 {
     FScopeLock Lock(&Mutex);
-    Grid.clear();
+    // Every node, bucket array and chunk lives in the arena, so the map is abandoned rather than destroyed.
+    Arena.Reset();
+    new (&Grid) CellMap(1024, std::hash<uint64>(), std::equal_to<uint64>(), CellMap::allocator_type(&Arena));
 }
 
 SIZE_T FSpatialGrid::GetMemoryUsage() const
 {
     FScopeLock Lock(&Mutex);
-    SIZE_T Total = 0;
-    for (const auto& Pair : Grid)
-    {
-        Total += sizeof(Pair.first) + Pair.second.GetAllocatedSize();
-    }
-    return Total;
+    return Arena.GetAllocatedBytes();
 }
 
 uint32 FLightLockHasher::HashWorldSpace(const FVector& Position, const FVector& Normal, float Precision)
@@ -167,123 +674,676 @@ uint32 FLightLockHasher::HashLightmapSpace(uint32 MeshID, const FVector2D& UV, u
     return Hash;
 }
 
-FLightLockCore::FLightLockCore(const FLightLockConfig& InConfig) : Config(InConfig), CurrentFrame(0)
+FLightLockEnvironmentKey FLightLockHasher::MakeEnvironmentKey(float TimeOfDayHours, int32 BucketsPerDay, TArrayView<const FName> EnabledLights)
+{
+    FLightLockEnvironmentKey Key;
+    int32 Buckets = FMath::Max(BucketsPerDay, 1);
+    float Wrapped = FMath::Fmod(FMath::Fmod(TimeOfDayHours, 24.0f) + 24.0f, 24.0f);
+    Key.TimeOfDayBucket = FMath::Min(FMath::FloorToInt(Wrapped / 24.0f * Buckets), Buckets - 1);
+    
+    // Order-independent so the same set of lights always maps to the same variant.
+    uint32 LightHash = 0;
+    for (const FName& Light : EnabledLights)
+    {
+        FString LightName = Light.ToString();
+        uint32 NameHash = 2166136261u;
+        for (TCHAR Char : LightName)
+        {
+            NameHash = (NameHash ^ static_cast<uint32>(FChar::ToLower(Char))) * 16777619u;
+        }
+        LightHash += NameHash;
+    }
+    Key.LightSetHash = static_cast<int32>(LightHash);
+    return Key;
+}
+
+uint64 FLightLockHasher::MortonCode(const FVector& Position, float CellSize)
+{
+    // 21 bits per axis, biased so negative coordinates sort before positive ones.
+    auto Spread = [](uint64 Value)
+    {
+        Value &= 0x1FFFFF;
+        Value = (Value | (Value << 32)) & 0x1F00000000FFFFull;
+        Value = (Value | (Value << 16)) & 0x1F0000FF0000FFull;
+        Value = (Value | (Value << 8)) & 0x100F00F00F00F00Full;
+        Value = (Value | (Value << 4)) & 0x10C30C30C30C30C3ull;
+        Value = (Value | (Value << 2)) & 0x1249249249249249ull;
+        return Value;
+    };
+    auto Cell = [CellSize](double Coordinate)
+    {
+        int64 Index = FMath::FloorToInt64(Coordinate / CellSize) + (1 << 20);
+        return static_cast<uint64>(FMath::Clamp<int64>(Index, 0, 0x1FFFFF));
+    };
+    return Spread(Cell(Position.X)) | (Spread(Cell(Position.Y)) << 1) | (Spread(Cell(Position.Z)) << 2);
+}
+
+FVector FLightLockHasher::MortonDecode(uint64 Code, float CellSize)
+{
+    auto Compact = [](uint64 Value)
+    {
+        Value &= 0x1249249249249249ull;
+        Value = (Value ^ (Value >> 2)) & 0x10C30C30C30C30C3ull;
+        Value = (Value ^ (Value >> 4)) & 0x100F00F00F00F00Full;
+        Value = (Value ^ (Value >> 8)) & 0x1F0000FF0000FFull;
+        Value = (Value ^ (Value >> 16)) & 0x1F00000000FFFFull;
+        Value = (Value ^ (Value >> 32)) & 0x1FFFFF;
+        return Value;
+    };
+    auto Coordinate = [CellSize](uint64 Index) { return (static_cast<double>(Index) - (1 << 20)) * CellSize; };
+    return FVector(Coordinate(Compact(Code)), Coordinate(Compact(Code >> 1)), Coordinate(Compact(Code >> 2)));
+}
+
+FLightLockCore::FLightLockCore(const FLightLockConfig& InConfig)
+    : Config(InConfig)
+    , CurrentFrame(0)
+    , StaticCapacityLimit(FMath::Max(InConfig.StaticCapacity, 1))
+    , DynamicCapacityLimit(FMath::Max(InConfig.DynamicCapacity, 1))
+    , DynamicCache(DynamicArena)
 {
     SpatialIndex = MakeUnique<FSpatialGrid>();
-    StaticCache.reserve(Config.StaticCapacity);
-    DynamicCache.reserve(Config.DynamicCapacity);
-    Load();
+    if (Config.AdmissionPolicy == ELightLockAdmissionPolicy::TinyLFU)
+    {
+        Admission = MakeUnique<FLightLockAdmissionFilter>(Config.AdmissionSketchWidth, Config.AdmissionAgingFrames);
+    }
+    if (Config.MemoryBudgetMB > 0)
+    {
+        Governor = MakeUnique<FLightLockMemoryGovernor>(
+            static_cast<SIZE_T>(Config.MemoryBudgetMB) * 1024 * 1024,
+            Config.StaticBudgetFraction,
+            Config.bAdaptiveBudget,
+            FLightLockStaticTable::ESTIMATED_BYTES_PER_ENTRY,
+            sizeof(DynamicMap::value_type) + 2 * sizeof(void*) + sizeof(uint32));
+        StaticCapacityLimit = Governor->GetStaticCapacity();
+        DynamicCapacityLimit = Governor->GetDynamicCapacity();
+        MemoryTrimHandle = FCoreDelegates::GetMemoryTrimDelegate().AddRaw(Governor.Get(), &FLightLockMemoryGovernor::NotifyMemoryTrim);
+    }
+    if (Config.bEnableStoreQueue)
+    {
+        StoreQueue = MakeUnique<TLightLockMpscQueue<PendingStore>>(static_cast<uint32>(FMath::Max(Config.StoreQueueCapacity, 2)));
+        DrainBuffer.Reserve(StoreQueue->GetCapacity());
+    }
+    {
+        FScopeLock Lock(&StaticMutex);
+        ActiveStatic = AddStaticLayer(Config.Environment);
+    }
+    if (Config.bEnableSharedStaticCache)
+    {
+        FString SharedName = FString::Printf(TEXT("%s_%08x"), *Config.SharedCacheName, GetTypeHash(GetCacheFilePath(Config.Environment)));
+        SharedCache = FLightLockSharedCache::Open(SharedName, static_cast<uint32>(FMath::Max(Config.StaticCapacity, 1)), Config.Environment);
+    }
+    if (SharedCache.IsValid() && !SharedCache->IsOwner())
+    {
+        // Another process owns the shared copy; serve static misses from it instead of loading the file.
+        FScopeLock Lock(&StaticMutex);
+        ActiveStatic->bSharedReadOnly = true;
+    }
+    else
+    {
+        Load(*ActiveStatic);
+    }
     UE_LOG(LogTemp, Log, TEXT("LightLock: Initialized"));
 }
 
 FLightLockCore::~FLightLockCore()
 {
+    if (MemoryTrimHandle.IsValid())
+    {
+        FCoreDelegates::GetMemoryTrimDelegate().Remove(MemoryTrimHandle);
+    }
+    WaitForLoads();
+    DrainStoreQueue();
     Save();
+    WaitForSaves();
 }
 
 bool FLightLockCore::Query(uint32 Hash, const FVector& Position, const FVector& Normal, FLinearColor& OutColor, float& OutWeight)
 {
-    Stats.TotalQueries++;
+    LIGHTLOCK_SCOPE_OP(Query, ETimedOp::Query);
+    BumpStat(EStatCounter::TotalQueries);
+    if (Admission.IsValid()) Admission->Record(Hash);
     bool bHit = false;
     FLinearColor RawColor = FLinearColor::Black;
     
     {
-        FScopeLock Lock(&StaticMutex);
-        auto It = StaticCache.find(Hash);
-        if (It != StaticCache.end())
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        FLightPath SharedPath;
+        const FLightPath* StaticPath = ActiveStatic->Cache.Find(Hash);
+        if (!StaticPath && ActiveStatic->bSharedReadOnly && SharedCache->Find(Hash, SharedPath))
+        {
+            StaticPath = &SharedPath;
+        }
+        if (StaticPath)
         {
-            const FLightPath& Path = It->second;
+            const FLightPath& Path = *StaticPath;
             if (Path.ValidatePosition(Position) && Path.ValidateNormal(Normal))
             {
                 RawColor = Path.Color;
+                if (BlendStatic && BlendAlpha > 0.0f)
+                {
+                    const FLightPath* BlendPath = BlendStatic->Cache.Find(Hash);
+                    if (BlendPath && BlendPath->ValidatePosition(Position))
+                    {
+                        RawColor = FMath::Lerp(RawColor, BlendPath->Color, BlendAlpha);
+                    }
+                }
                 OutWeight = Path.Weight;
-                Stats.StaticHits++;
+                ActiveStatic->Access.Record(Hash, CurrentFrame.load(std::memory_order_relaxed));
+                BumpStat(EStatCounter::StaticHits);
+                if (StaticPath == &SharedPath) BumpStat(EStatCounter::SharedHits);
                 bHit = true;
             }
             else
             {
-                Stats.CollisionsDetected++;
+                BumpStat(EStatCounter::CollisionsDetected);
             }
         }
     }
     
     if (!bHit)
     {
-        FScopeLock Lock(&DynamicMutex);
-        auto It = DynamicCache.find(Hash);
-        if (It != DynamicCache.end())
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        if (DynamicEntry* Found = DynamicCache.Find(Hash))
         {
-            DynamicEntry& Entry = It->second;
+            DynamicEntry& Entry = *Found;
             if (Entry.Path.ValidatePosition(Position) && Entry.Path.ValidateNormal(Normal))
             {
                 RawColor = Entry.Path.Color;
                 OutWeight = Entry.Path.Weight;
-                Entry.LastAccessFrame = CurrentFrame.load();
-                Stats.DynamicHits++;
+                BumpStat(EStatCounter::DynamicHits);
                 bHit = true;
-                uint32 Age = CurrentFrame.load() - Entry.LastAccessFrame;
-                if (Age > static_cast<uint32>(Config.PromotionFrameThreshold))
+                if (TouchDynamic(Entry, CurrentFrame.load()))
                 {
                     PromoteToStatic(Hash, Entry.Path);
                 }
             }
             else
             {
-                Stats.CollisionsDetected++;
+                BumpStat(EStatCounter::CollisionsDetected);
             }
         }
     }
     
-    if (!bHit) Stats.Misses++;
+    if (!bHit) BumpStat(EStatCounter::Misses);
     OutColor = ApplyTemporalSmoothing(Hash, RawColor, !bHit);
+    
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::Query;
+        Event.Hash = Hash;
+        Event.Position = Position;
+        Event.Normal = Normal;
+        Event.bHit = bHit;
+        RecordTrace(Event);
+    }
     return bHit;
 }
 
-void FLightLockCore::Store(uint32 Hash, const FLinearColor& Color, float Weight, const FVector& Position, const FVector& Normal, bool bIsStatic, uint8 BounceCount, float Confidence)
+int32 FLightLockCore::QueryBatch(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TArrayView<FLinearColor> OutColors, TArrayView<float> OutWeights, bool bInterpolate)
 {
-    FLightPath Path = FLightPath::Create(Color, Weight, Position, Normal, BounceCount, Confidence);
-    if (bIsStatic)
+    LIGHTLOCK_SCOPE_OP(QueryBatch, ETimedOp::QueryBatch);
+    const int32 Num = Positions.Num();
+    check(Normals.Num() == Num || Normals.Num() == 1);
+    check(OutColors.Num() == Num && OutWeights.Num() == Num);
+    if (Num == 0) return 0;
+    
+    float Precision = GetWorldSpacePrecision();
+    std::atomic<int32> Hits{0};
+    const int32 NumChunks = FMath::DivideAndRoundUp(Num, QUERY_BATCH_CHUNK);
+    ParallelFor(NumChunks, [&](int32 ChunkIndex)
     {
-        FScopeLock Lock(&StaticMutex);
-        if (StaticCache.size() >= static_cast<size_t>(Config.StaticCapacity))
+        int32 First = ChunkIndex * QUERY_BATCH_CHUNK;
+        int32 Count = FMath::Min(QUERY_BATCH_CHUNK, Num - First);
+        TConstArrayView<FVector> ChunkNormals = Normals.Num() == 1 ? Normals : Normals.Slice(First, Count);
+        Hits += QueryBatchChunk(Positions.Slice(First, Count), ChunkNormals, OutColors.Slice(First, Count), OutWeights.Slice(First, Count), Precision, bInterpolate);
+    }, NumChunks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+    return Hits.load();
+}
+
+int32 FLightLockCore::QueryBatchChunk(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TArrayView<FLinearColor> OutColors, TArrayView<float> OutWeights, float Precision, bool bInterpolate)
+{
+    // Each point probes its own cell, or with interpolation the 8 cell centres around it.
+    struct FProbe
+    {
+        uint32 Hash;
+        int32 Point;
+        float Weight;
+        FVector Position;
+    };
+    
+    const int32 Num = Positions.Num();
+    FMemMark Mark(FMemStack::Get());
+    TArray<FProbe, TMemStackAllocator<>> Probes;
+    Probes.Reserve(Num * (bInterpolate ? 8 : 1));
+    for (int32 i = 0; i < Num; ++i)
+    {
+        const FVector& Normal = Normals[Normals.Num() == 1 ? 0 : i];
+        if (!bInterpolate)
+        {
+            Probes.Add({ FLightLockHasher::HashWorldSpace(Positions[i], Normal, Precision), i, 1.0f, Positions[i] });
+            continue;
+        }
+        FVector Cell = Positions[i] / Precision;
+        FVector Base(FMath::FloorToDouble(Cell.X), FMath::FloorToDouble(Cell.Y), FMath::FloorToDouble(Cell.Z));
+        FVector Frac = Cell - Base;
+        for (int32 Corner = 0; Corner < 8; ++Corner)
         {
-            EvictLowestConfidenceStatic();
+            FVector Offset(Corner & 1, (Corner >> 1) & 1, (Corner >> 2) & 1);
+            float Weight = (Offset.X > 0 ? Frac.X : 1.0 - Frac.X) * (Offset.Y > 0 ? Frac.Y : 1.0 - Frac.Y) * (Offset.Z > 0 ? Frac.Z : 1.0 - Frac.Z);
+            if (Weight <= 0.0f) continue;
+            FVector CornerPosition = (Base + Offset) * Precision;
+            Probes.Add({ FLightLockHasher::HashWorldSpace(CornerPosition, Normal, Precision), i, Weight, CornerPosition });
         }
-        StaticCache[Hash] = Path;
     }
-    else
+    if (Admission.IsValid())
     {
-        FScopeLock Lock(&DynamicMutex);
-        if (DynamicCache.size() >= static_cast<size_t>(Config.DynamicCapacity))
+        for (const FProbe& Probe : Probes)
         {
-            EvictLRUOrLowConfidenceDynamic();
+            Admission->Record(Probe.Hash);
         }
-        DynamicEntry Entry;
-        Entry.Path = Path;
-        Entry.LastAccessFrame = CurrentFrame.load();
-        Entry.WorldPosition = Position;
-        DynamicCache[Hash] = Entry;
-        SpatialIndex->Insert(Position, Hash);
     }
-}
-
-void FLightLockCore::InvalidateRegion(const FBox& Region)
-{
-    TArray<uint32> Affected = SpatialIndex->QueryRegion(Region);
+    
+    // Per point: blended colour and weight, the interpolation weight that hit, and which layers hit.
+    TArray<FLinearColor, TMemStackAllocator<>> Colors;
+    TArray<float, TMemStackAllocator<>> Weights;
+    TArray<float, TMemStackAllocator<>> Coverage;
+    TArray<uint8, TMemStackAllocator<>> Sources;
+    Colors.Init(FLinearColor::Black, Num);
+    Weights.Init(0.0f, Num);
+    Coverage.Init(0.0f, Num);
+    Sources.Init(0, Num);
+    TArray<bool, TMemStackAllocator<>> Resolved;
+    Resolved.Init(false, Probes.Num());
+    auto Accumulate = [&](int32 ProbeIndex, const FLinearColor& Color, float PathWeight, uint8 Source)
     {
-        FScopeLock Lock(&DynamicMutex);
-        for (uint32 Hash : Affected)
+        const FProbe& Probe = Probes[ProbeIndex];
+        Colors[Probe.Point] += Color * Probe.Weight;
+        Weights[Probe.Point] += PathWeight * Probe.Weight;
+        Coverage[Probe.Point] += Probe.Weight;
+        Sources[Probe.Point] |= Source;
+        Resolved[ProbeIndex] = true;
+    };
+    
+    uint32 Frame = CurrentFrame.load(std::memory_order_relaxed);
+    TArray<FLightLockCacheEntry, TMemStackAllocator<>> Promotions;
+    {
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        for (int32 ProbeIndex = 0; ProbeIndex < Probes.Num(); ++ProbeIndex)
         {
-            auto It = DynamicCache.find(Hash);
-            if (It != DynamicCache.end())
+            const FProbe& Probe = Probes[ProbeIndex];
+            FLightPath SharedPath;
+            const FLightPath* Path = ActiveStatic->Cache.Find(Probe.Hash);
+            if (!Path && ActiveStatic->bSharedReadOnly && SharedCache->Find(Probe.Hash, SharedPath))
             {
-                FVector Pos = It->second.WorldPosition;
-                SpatialIndex->Remove(Pos, Hash);
-                DynamicCache.erase(It);
+                Path = &SharedPath;
+            }
+            const FVector& Normal = Normals[Normals.Num() == 1 ? 0 : Probe.Point];
+            if (!Path || !Path->ValidatePosition(Probe.Position) || !Path->ValidateNormal(Normal)) continue;
+            FLinearColor Color = Path->Color;
+            if (BlendStatic && BlendAlpha > 0.0f)
+            {
+                const FLightPath* BlendPath = BlendStatic->Cache.Find(Probe.Hash);
+                if (BlendPath && BlendPath->ValidatePosition(Probe.Position))
+                {
+                    Color = FMath::Lerp(Color, BlendPath->Color, BlendAlpha);
+                }
             }
+            ActiveStatic->Access.Record(Probe.Hash, Frame);
+            Accumulate(ProbeIndex, Color, Path->Weight, 1);
         }
     }
-    Stats.SpatialInvalidations++;
+    {
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        for (int32 ProbeIndex = 0; ProbeIndex < Probes.Num(); ++ProbeIndex)
+        {
+            if (Resolved[ProbeIndex]) continue;
+            const FProbe& Probe = Probes[ProbeIndex];
+            DynamicEntry* Found = DynamicCache.Find(Probe.Hash);
+            const FVector& Normal = Normals[Normals.Num() == 1 ? 0 : Probe.Point];
+            if (!Found || !Found->Path.ValidatePosition(Probe.Position) || !Found->Path.ValidateNormal(Normal)) continue;
+            if (TouchDynamic(*Found, Frame))
+            {
+                Promotions.Add({ Probe.Hash, Found->Path });
+            }
+            Accumulate(ProbeIndex, Found->Path.Color, Found->Path.Weight, 2);
+        }
+    }
+    if (Promotions.Num() > 0)
+    {
+        // Same promotion as Query, one static lock for the chunk.
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        for (const FLightLockCacheEntry& Promotion : Promotions)
+        {
+            StoreStatic(Promotion.Hash, Promotion.Path);
+        }
+        BumpStat(EStatCounter::Promotions, Promotions.Num());
+    }
+    
+    int32 StaticHits = 0;
+    int32 DynamicHits = 0;
+    for (int32 i = 0; i < Num; ++i)
+    {
+        if (Coverage[i] > 0.0f)
+        {
+            OutColors[i] = Colors[i] / Coverage[i];
+            OutWeights[i] = Weights[i] / Coverage[i];
+            (Sources[i] & 1 ? StaticHits : DynamicHits)++;
+        }
+        else
+        {
+            OutColors[i] = FLinearColor::Black;
+            OutWeights[i] = 0.0f;
+        }
+    }
+    if (IsTracing())
+    {
+        // One query per point at its own cell, so a replay sees batch traffic too.
+        for (int32 i = 0; i < Num; ++i)
+        {
+            const FVector& Normal = Normals[Normals.Num() == 1 ? 0 : i];
+            FLightLockTraceEvent Event;
+            Event.Op = ELightLockTraceOp::Query;
+            Event.Hash = bInterpolate ? FLightLockHasher::HashWorldSpace(Positions[i], Normal, Precision) : Probes[i].Hash;
+            Event.Position = Positions[i];
+            Event.Normal = Normal;
+            Event.bHit = Coverage[i] > 0.0f;
+            RecordTrace(Event);
+        }
+    }
+    int32 Hits = StaticHits + DynamicHits;
+    BumpStat(EStatCounter::TotalQueries, Num);
+    BumpStat(EStatCounter::StaticHits, StaticHits);
+    BumpStat(EStatCounter::DynamicHits, DynamicHits);
+    BumpStat(EStatCounter::Misses, Num - Hits);
+    return Hits;
+}
+
+void FLightLockCore::Store(uint32 Hash, const FLinearColor& Color, float Weight, const FVector& Position, const FVector& Normal, bool bIsStatic, uint8 BounceCount, float Confidence)
+{
+    LIGHTLOCK_SCOPE_OP(Store, ETimedOp::Store);
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::Store;
+        Event.Hash = Hash;
+        Event.Position = Position;
+        Event.Normal = Normal;
+        Event.Color = Color;
+        Event.Weight = Weight;
+        Event.Confidence = Confidence;
+        Event.BounceCount = BounceCount;
+        Event.bIsStatic = bIsStatic;
+        RecordTrace(Event);
+    }
+    
+    FLightPath Path = FLightPath::Create(Color, Weight, Position, Normal, BounceCount, Confidence);
+    if (StoreQueue.IsValid())
+    {
+        PendingStore Pending;
+        Pending.Hash = Hash;
+        Pending.Path = Path;
+        Pending.Position = Position;
+        Pending.bIsStatic = bIsStatic;
+        if (StoreQueue->Enqueue(Pending))
+        {
+            BumpStat(EStatCounter::QueuedStores);
+        }
+        else
+        {
+            BumpStat(EStatCounter::DroppedStores);
+        }
+        return;
+    }
+    
+    if (bIsStatic)
+    {
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        StoreStatic(Hash, Path);
+    }
+    else
+    {
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        StoreDynamic(Hash, Path, Position);
+    }
+}
+
+bool FLightLockCore::StoreStatic(uint32 Hash, const FLightPath& Path, bool bRecordChange)
+{
+    FLightLockStaticTable& StaticCache = ActiveStatic->Cache;
+    uint32 Victim;
+    if (StaticCache.Num() >= StaticCapacityLimit.load(std::memory_order_relaxed) && !StaticCache.Find(Hash) && FindStaticVictim(Victim))
+    {
+        if (Admission.IsValid() && !Admission->Admit(Hash, Victim))
+        {
+            BumpStat(EStatCounter::AdmissionRejects);
+            return false;
+        }
+        EvictStatic(Victim);
+    }
+    StaticCache.Add(Hash, Path);
+    if (bRecordChange)
+    {
+        TArray<TPair<uint64, uint32>>& Changes = ActiveStatic->Changes;
+        TPair<uint64, uint32> Change(++StaticEpoch, Hash);
+        if (Changes.Num() < MAX_STATIC_CHANGES)
+        {
+            Changes.Add(Change);
+        }
+        else
+        {
+            ActiveStatic->DroppedEpoch = Changes[ActiveStatic->NextChange].Key;
+            Changes[ActiveStatic->NextChange] = Change;
+            ActiveStatic->NextChange = (ActiveStatic->NextChange + 1) % MAX_STATIC_CHANGES;
+        }
+    }
+    return true;
+}
+
+void FLightLockCore::StoreDynamic(uint32 Hash, const FLightPath& Path, const FVector& Position)
+{
+    if (const DynamicEntry* Existing = DynamicCache.Find(Hash))
+    {
+        SpatialIndex->Remove(Existing->WorldPosition, Hash);
+    }
+    else if (DynamicCache.Num() >= static_cast<size_t>(DynamicCapacityLimit.load(std::memory_order_relaxed)))
+    {
+        uint32 Victim;
+        if (FindDynamicVictim(Victim))
+        {
+            if (Admission.IsValid() && !Admission->Admit(Hash, Victim))
+            {
+                BumpStat(EStatCounter::AdmissionRejects);
+                return;
+            }
+            EvictDynamic(Victim);
+        }
+    }
+    DynamicEntry Entry;
+    Entry.Path = Path;
+    Entry.LastAccessFrame = CurrentFrame.load();
+    Entry.WorldPosition = Position;
+    DynamicCache.FindOrAdd(Hash) = Entry;
+    SpatialIndex->Insert(Position, Hash);
+}
+
+void FLightLockCore::ResetStaticLayer(StaticLayer& Layer)
+{
+    Layer.Cache.Reset();
+    Layer.Access.Reset();
+    // Logged hashes are gone with the entries; exports skip hashes no longer present anyway.
+    Layer.Changes.Empty();
+    Layer.NextChange = 0;
+    Layer.DroppedEpoch = 0;
+}
+
+void FLightLockCore::ResetDynamicTable()
+{
+    // The map's memory is owned by the arena, so drop both in O(1) and rebuild an empty map in place.
+    DynamicArena.Reset();
+    DynamicCache.ResetAfterArenaReset();
+}
+
+void FLightLockCore::DrainStoreQueue()
+{
+    if (!StoreQueue.IsValid()) return;
+    SCOPE_CYCLE_COUNTER(STAT_LightLock_DrainStoreQueue);
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_DrainStoreQueue);
+    FScopeLock DrainLock(&DrainMutex);
+    
+    DrainBuffer.Reset();
+    PendingStore Pending;
+    while (StoreQueue->Dequeue(Pending))
+    {
+        DrainBuffer.Add(Pending);
+    }
+    if (DrainBuffer.Num() == 0) return;
+    
+    // Stable so that repeated stores to one hash keep their submission order (last write wins).
+    Algo::StableSortBy(DrainBuffer, [](const PendingStore& Entry) { return (static_cast<uint64>(Entry.bIsStatic) << 32) | Entry.Hash; });
+    int32 FirstStatic = Algo::LowerBoundBy(DrainBuffer, true, [](const PendingStore& Entry) { return Entry.bIsStatic; });
+    
+    if (FirstStatic > 0)
+    {
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        for (int32 i = 0; i < FirstStatic; ++i)
+        {
+            StoreDynamic(DrainBuffer[i].Hash, DrainBuffer[i].Path, DrainBuffer[i].Position);
+        }
+    }
+    if (FirstStatic < DrainBuffer.Num())
+    {
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        for (int32 i = FirstStatic; i < DrainBuffer.Num(); ++i)
+        {
+            StoreStatic(DrainBuffer[i].Hash, DrainBuffer[i].Path);
+        }
+    }
+}
+
+uint64 FLightLockCore::ExportDelta(uint64 SinceEpoch, TArray<uint8>& OutBytes) const
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_ExportDelta);
+    FLightLockDeltaHeader Header;
+    TArray<FLightLockCacheEntry> Entries;
+    {
+        FScopeLock Lock(&StaticMutex);
+        const StaticLayer& Layer = *ActiveStatic;
+        Header.Environment = Layer.Key;
+        Header.WorldSpacePrecision = Config.WorldSpacePrecision;
+        Header.Epoch = StaticEpoch;
+        auto AddEntry = [&Entries](uint32 Hash, const FLightPath& Path)
+        {
+            FLightLockCacheEntry& Entry = Entries.AddDefaulted_GetRef();
+            Entry.Hash = Hash;
+            Entry.Path = Path;
+        };
+        // Loaded entries were never logged, so epoch 0 always sends the whole layer.
+        if (SinceEpoch == 0 || SinceEpoch < Layer.DroppedEpoch)
+        {
+            Layer.Cache.ForEach(AddEntry);
+        }
+        else
+        {
+            // A hash stored several times is logged several times but sent once, with its current path.
+            TSet<uint32> Seen;
+            for (const TPair<uint64, uint32>& Change : Layer.Changes)
+            {
+                if (Change.Key <= SinceEpoch) continue;
+                bool bAlreadySeen = false;
+                Seen.Add(Change.Value, &bAlreadySeen);
+                if (bAlreadySeen) continue;
+                if (const FLightPath* Path = Layer.Cache.Find(Change.Value))
+                {
+                    AddEntry(Change.Value, *Path);
+                }
+            }
+        }
+    }
+    FLightLockDeltaCodec::Encode(Header, Entries, OutBytes);
+    UE_LOG(LogTemp, Verbose, TEXT("LightLock: Exported %d entries since epoch %llu (%d bytes)"), Entries.Num(), SinceEpoch, OutBytes.Num());
+    return Header.Epoch;
+}
+
+FLightLockDeltaImportResult FLightLockCore::ImportDelta(TConstArrayView<uint8> Bytes)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_ImportDelta);
+    FLightLockDeltaImportResult Result;
+    FLightLockDeltaHeader Header;
+    TArray<FLightLockCacheEntry> Entries;
+    if (!FLightLockDeltaCodec::Decode(Bytes, Header, Entries))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Ignoring a malformed cache delta"));
+        return Result;
+    }
+    
+    LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+    if (Header.Environment != ActiveStatic->Key || Header.WorldSpacePrecision != Config.WorldSpacePrecision || ActiveStatic->bSharedReadOnly)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Ignoring a cache delta for another environment or precision"));
+        return Result;
+    }
+    Result.bAccepted = true;
+    for (const FLightLockCacheEntry& Entry : Entries)
+    {
+        bool bExists = false;
+        if (const FLightPath* Existing = ActiveStatic->Cache.Find(Entry.Hash))
+        {
+            bExists = true;
+            // Compare at wire precision, so re-importing an entry this instance exported is a no-op.
+            uint8 ExistingConfidence = FLightLockDeltaCodec::QuantizeConfidence(Existing->Confidence);
+            uint8 IncomingConfidence = FLightLockDeltaCodec::QuantizeConfidence(Entry.Path.Confidence);
+            bool bReplace = IncomingConfidence > ExistingConfidence
+                || (IncomingConfidence == ExistingConfidence && Entry.Path.BounceCount > Existing->BounceCount);
+            if (!bReplace)
+            {
+                Result.Kept++;
+                continue;
+            }
+        }
+        if (!StoreStatic(Entry.Hash, Entry.Path, false))
+        {
+            Result.Kept++;
+        }
+        else if (bExists)
+        {
+            Result.Replaced++;
+        }
+        else
+        {
+            Result.Added++;
+        }
+    }
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Imported cache delta: %d added, %d replaced, %d kept"), Result.Added, Result.Replaced, Result.Kept);
+    return Result;
+}
+
+void FLightLockCore::InvalidateRegion(const FBox& Region)
+{
+    LIGHTLOCK_SCOPE_OP(InvalidateRegion, ETimedOp::Invalidate);
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::InvalidateRegion;
+        Event.Region = Region;
+        RecordTrace(Event);
+    }
+    
+    FMemMark Mark(FMemStack::Get());
+    TArray<uint32, TMemStackAllocator<>> Affected;
+    SpatialIndex->QueryRegion(Region, Affected);
+    {
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        for (uint32 Hash : Affected)
+        {
+            if (const DynamicEntry* Found = DynamicCache.Find(Hash))
+            {
+                SpatialIndex->Remove(Found->WorldPosition, Hash);
+                DynamicCache.Remove(Hash);
+            }
+        }
+    }
+    BumpStat(EStatCounter::SpatialInvalidations);
 }
 
 void FLightLockCore::InvalidateSphere(const FVector& Center, float Radius)
@@ -294,6 +1354,18 @@ void FLightLockCore::InvalidateSphere(const FVector& Center, float Radius)
 
 void FLightLockCore::UpdateCamera(const FVector& CameraPosition, const FVector& CameraForward, float FOV, float FarPlane, float DeltaTime)
 {
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::UpdateCamera;
+        Event.Position = CameraPosition;
+        Event.Normal = CameraForward;
+        Event.FOV = FOV;
+        Event.FarPlane = FarPlane;
+        Event.DeltaTime = DeltaTime;
+        RecordTrace(Event);
+    }
+    
     if (Config.bEnablePredictiveLoading && DeltaTime > 0.0f)
     {
         FVector Velocity = (CameraPosition - PrevCameraPos) / DeltaTime;
@@ -301,215 +1373,1278 @@ void FLightLockCore::UpdateCamera(const FVector& CameraPosition, const FVector&
         PrevCameraPos = CameraPosition;
         PrevCameraDir = CameraForward;
     }
+    SetLoadFocus(CameraPosition);
+}
+
+void FLightLockCore::SetLoadFocus(const FVector& Position)
+{
+    FScopeLock Lock(&StaticMutex);
+    LoadFocus = Position;
+    bHasLoadFocus = true;
 }
 
 void FLightLockCore::CullDistantEntries(const FVector& CameraPosition, float MaxDistance)
 {
-    FScopeLock Lock(&DynamicMutex);
-    TArray<uint32> ToRemove;
-    ToRemove.Reserve(DynamicCache.size() / 10);
-    for (const auto& Pair : DynamicCache)
+    LIGHTLOCK_SCOPE_OP(CullDistantEntries, ETimedOp::Cull);
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::CullDistantEntries;
+        Event.Position = CameraPosition;
+        Event.MaxDistance = MaxDistance;
+        RecordTrace(Event);
+    }
+    
+    LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+    FMemMark Mark(FMemStack::Get());
+    TArray<uint32, TMemStackAllocator<>> ToRemove;
+    ToRemove.Reserve(DynamicCache.Num() / 10);
+    DynamicCache.ForEach([&](uint32 Hash, const DynamicEntry& Entry)
     {
-        float Distance = FVector::Dist(CameraPosition, Pair.second.WorldPosition);
+        float Distance = FVector::Dist(CameraPosition, Entry.WorldPosition);
         if (Distance > MaxDistance)
         {
-            ToRemove.Add(Pair.first);
+            ToRemove.Add(Hash);
         }
-    }
+    });
     for (uint32 Hash : ToRemove)
     {
-        auto It = DynamicCache.find(Hash);
-        if (It != DynamicCache.end())
+        if (const DynamicEntry* Found = DynamicCache.Find(Hash))
+        {
+            SpatialIndex->Remove(Found->WorldPosition, Hash);
+            DynamicCache.Remove(Hash);
+        }
+    }
+}
+
+void FLightLockCore::AdvanceFrame()
+{
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::AdvanceFrame;
+        RecordTrace(Event);
+    }
+    DrainStoreQueue();
+    if (SharedCache.IsValid() && SharedCache->Tick())
+    {
+        // The previous owner went away and this process took over: load the file privately and republish it.
+        StaticLayer* SharedLayer = nullptr;
         {
-            SpatialIndex->Remove(It->second.WorldPosition, Hash);
-            DynamicCache.erase(It);
+            FScopeLock Lock(&StaticMutex);
+            if (TUniquePtr<StaticLayer>* Found = StaticLayers.Find(SharedCache->GetEnvironment()))
+            {
+                SharedLayer = Found->Get();
+                SharedLayer->bSharedReadOnly = false;
+            }
         }
+        if (SharedLayer) Load(*SharedLayer);
     }
+    if (Admission.IsValid()) Admission->Age();
+    AdvanceTables();
+    uint32 Frame = ++CurrentFrame;
+    if (Governor.IsValid() && (Frame % GOVERNOR_INTERVAL_FRAMES == 0 || Governor->IsTrimRequested()))
+    {
+        UpdateMemoryBudget();
+    }
+#if LIGHTLOCK_ENABLE_INSTRUMENTATION
+    PublishFrameStats();
+#endif
 }
 
-void FLightLockCore::AdvanceFrame() { CurrentFrame++; }
-void FLightLockCore::Flush() { Save(); }
+void FLightLockCore::Flush()
+{
+    DrainStoreQueue();
+    Save();
+}
 
 void FLightLockCore::ClearDynamic()
 {
-    { FScopeLock Lock(&DynamicMutex); DynamicCache.clear(); }
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::ClearDynamic;
+        RecordTrace(Event);
+    }
+    { FScopeLock Lock(&DynamicMutex); ResetDynamicTable(); }
     SpatialIndex->Clear();
-    PreviousColors.Empty();
+    for (SmoothingShard& Shard : SmoothingShards)
+    {
+        FScopeLock Lock(&Shard.Mutex);
+        Shard.PreviousColors.Empty();
+    }
 }
 
 void FLightLockCore::ClearAll()
 {
-    { FScopeLock Lock(&StaticMutex); StaticCache.clear(); }
+    if (IsTracing())
+    {
+        FLightLockTraceEvent Event;
+        Event.Op = ELightLockTraceOp::ClearAll;
+        RecordTrace(Event);
+    }
+    {
+        FScopeLock Lock(&StaticMutex);
+        // Loads still streaming in would refill the layers with what was just cleared.
+        ++LoadGeneration;
+        for (auto& Pair : StaticLayers)
+        {
+            ResetStaticLayer(*Pair.Value);
+        }
+    }
     ClearDynamic();
 }
 
 FLightLockStats FLightLockCore::GetStats() const
 {
     FLightLockStats Result;
-    Result.StaticCount = StaticCache.size();
-    Result.DynamicCount = DynamicCache.size();
-    Result.TotalQueries = Stats.TotalQueries.load();
-    Result.Misses = Stats.Misses.load();
-    Result.Collisions = Stats.CollisionsDetected.load();
-    Result.Promotions = Stats.Promotions.load();
-    Result.SpatialInvalidations = Stats.SpatialInvalidations.load();
+    {
+        FScopeLock Lock(&StaticMutex);
+        Result.StaticCount = ActiveStatic->Cache.Num();
+    }
+    {
+        FScopeLock Lock(&DynamicMutex);
+        Result.DynamicCount = DynamicCache.Num();
+    }
+    Result.TotalQueries = ReadStat(EStatCounter::TotalQueries);
+    Result.Misses = ReadStat(EStatCounter::Misses);
+    Result.Collisions = ReadStat(EStatCounter::CollisionsDetected);
+    Result.Promotions = ReadStat(EStatCounter::Promotions);
+    Result.SpatialInvalidations = ReadStat(EStatCounter::SpatialInvalidations);
+    Result.Evictions = ReadStat(EStatCounter::StaticEvictions) + ReadStat(EStatCounter::DynamicEvictions);
+    Result.MemoryUsageBytes = GetMemoryUsage();
+    Result.MemoryBudgetBytes = Governor.IsValid() ? Governor->GetBudgetBytes() : 0;
+    Result.StaticCapacity = StaticCapacityLimit.load();
+    Result.DynamicCapacity = DynamicCapacityLimit.load();
+    Result.QueuedStores = ReadStat(EStatCounter::QueuedStores);
+    Result.DroppedStores = ReadStat(EStatCounter::DroppedStores);
+    Result.PendingStores = StoreQueue.IsValid() ? StoreQueue->Num() : 0;
+    Result.SharedHits = ReadStat(EStatCounter::SharedHits);
+    Result.AdmissionRejects = ReadStat(EStatCounter::AdmissionRejects);
+    Result.SharedCount = SharedCache.IsValid() ? SharedCache->GetNumRecords() : 0;
+    Result.bSharedCacheOwner = SharedCache.IsValid() && SharedCache->IsOwner();
     if (Result.TotalQueries > 0)
     {
-        uint64 Hits = Stats.StaticHits.load() + Stats.DynamicHits.load();
+        uint64 Hits = ReadStat(EStatCounter::StaticHits) + ReadStat(EStatCounter::DynamicHits);
         Result.HitRate = static_cast<float>(Hits) / static_cast<float>(Result.TotalQueries);
     }
+#if LIGHTLOCK_ENABLE_INSTRUMENTATION
+    Result.QueryLatency = ReadLatency(ETimedOp::Query);
+    Result.StoreLatency = ReadLatency(ETimedOp::Store);
+    Result.EvictionLatency = ReadLatency(ETimedOp::Eviction);
+    Result.InvalidateLatency = ReadLatency(ETimedOp::Invalidate);
+    Result.CullLatency = ReadLatency(ETimedOp::Cull);
+    Result.SaveLatency = ReadLatency(ETimedOp::Save);
+    Result.QueryBatchLatency = ReadLatency(ETimedOp::QueryBatch);
+    Result.StaticLockWait = ReadLatency(ETimedOp::StaticLockWait);
+    Result.DynamicLockWait = ReadLatency(ETimedOp::DynamicLockWait);
+#endif
     return Result;
 }
 
 void FLightLockCore::ResetStats()
 {
-    Stats.TotalQueries = 0;
-    Stats.StaticHits = 0;
-    Stats.DynamicHits = 0;
-    Stats.Misses = 0;
-    Stats.Promotions = 0;
-    Stats.CollisionsDetected = 0;
-    Stats.SpatialInvalidations = 0;
+    for (StatShard& Shard : StatShards)
+    {
+        for (std::atomic<uint64>& Counter : Shard.Counters)
+        {
+            Counter.store(0, std::memory_order_relaxed);
+        }
+    }
+#if LIGHTLOCK_ENABLE_INSTRUMENTATION
+    for (LatencyShard& Shard : LatencyShards)
+    {
+        for (auto& OpBuckets : Shard.Buckets)
+        {
+            for (std::atomic<uint64>& Bucket : OpBuckets)
+            {
+                Bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (std::atomic<uint64>& Max : Shard.MaxNanoseconds)
+        {
+            Max.store(0, std::memory_order_relaxed);
+        }
+    }
+#endif
+}
+
+void FLightLockCore::StartTrace(int64 MaxTraceBytes)
+{
+    FScopeLock Lock(&TraceMutex);
+    TraceRecorder = MakeUnique<FLightLockTraceRecorder>(MaxTraceBytes, Config.WorldSpacePrecision);
+    bTraceEnabled.store(true);
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Trace started (%lld bytes)"), MaxTraceBytes);
 }
 
-void FLightLockCore::Load()
+void FLightLockCore::StopTrace()
 {
-    if (Config.bEnableAsyncLoading)
-    {
-        Async(EAsyncExecution::ThreadPool, [this]() { LoadSync(); });
-    }
-    else
+    bTraceEnabled.store(false);
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Trace stopped"));
+}
+
+bool FLightLockCore::SaveTrace(const FString& FilePath) const
+{
+    FScopeLock Lock(&TraceMutex);
+    return TraceRecorder.IsValid() && TraceRecorder->SaveToFile(FilePath);
+}
+
+void FLightLockCore::RecordTrace(const FLightLockTraceEvent& Event)
+{
+    FScopeLock Lock(&TraceMutex);
+    if (TraceRecorder.IsValid() && IsTracing())
     {
-        LoadSync();
+        TraceRecorder->Record(Event);
     }
 }
 
-void FLightLockCore::LoadSync()
+SIZE_T FLightLockCore::GetMemoryUsage() const
 {
-    FString FullPath = FPaths::ProjectSavedDir() / Config.CachePath;
-    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FullPath));
-    if (!Reader) return;
-    
-    uint32 Magic, Version, Count;
-    *Reader << Magic << Version << Count;
-    if (Magic != LIGHTLOCK_MAGIC || Version != LIGHTLOCK_VERSION) return;
-    
-    FScopeLock Lock(&StaticMutex);
-    StaticCache.reserve(FMath::Min(Count, static_cast<uint32>(Config.StaticCapacity)));
-    
-    for (uint32 i = 0; i < Count && StaticCache.size() < static_cast<size_t>(Config.StaticCapacity); ++i)
+    MemoryBreakdown Breakdown = ComputeMemoryBreakdown();
+    return Breakdown.StaticBytes + Breakdown.DynamicBytes + Breakdown.OverheadBytes;
+}
+
+FLightLockCore::MemoryBreakdown FLightLockCore::ComputeMemoryBreakdown() const
+{
+    MemoryBreakdown Result;
     {
-        uint32 Hash;
-        FLightPath Path;
-        *Reader << Hash;
-        *Reader << Path.Color.R << Path.Color.G << Path.Color.B << Path.Color.A;
-        *Reader << Path.Weight << Path.BounceCount << Path.Flags << Path.Confidence;
-        *Reader << Path.PositionValidation.X << Path.PositionValidation.Y << Path.PositionValidation.Z;
-        *Reader << Path.NormalValidation.X << Path.NormalValidation.Y << Path.NormalValidation.Z;
-        *Reader << Path.IncidentDirection.X << Path.IncidentDirection.Y << Path.IncidentDirection.Z;
-        *Reader << Path.Roughness;
-        if (!Reader->IsError())
+        FScopeLock Lock(&StaticMutex);
+        for (const auto& Pair : StaticLayers)
         {
-            StaticCache[Hash] = Path;
+            Result.StaticEntries += Pair.Value->Cache.Num();
+            Result.StaticBytes += Pair.Value->Cache.GetAllocatedBytes() + Pair.Value->Access.GetAllocatedBytes() + Pair.Value->Changes.GetAllocatedSize();
         }
     }
-    UE_LOG(LogTemp, Log, TEXT("LightLock: Loaded %zu entries"), StaticCache.size());
+    {
+        FScopeLock Lock(&DynamicMutex);
+        Result.DynamicEntries = DynamicCache.Num();
+        Result.DynamicBytes = DynamicArena.GetAllocatedBytes();
+    }
+    Result.DynamicBytes += SpatialIndex->GetMemoryUsage();
+    Result.OverheadBytes = sizeof(*this);
+    for (const SmoothingShard& Shard : SmoothingShards)
+    {
+        FScopeLock Lock(&Shard.Mutex);
+        Result.OverheadBytes += Shard.PreviousColors.GetAllocatedSize();
+    }
+    if (Admission.IsValid())
+    {
+        Result.OverheadBytes += Admission->GetAllocatedBytes();
+    }
+    if (StoreQueue.IsValid())
+    {
+        Result.OverheadBytes += StoreQueue->GetCapacity() * (sizeof(PendingStore) + sizeof(uint64)) + DrainBuffer.GetAllocatedSize();
+    }
+    return Result;
 }
 
-void FLightLockCore::Save() const
+void FLightLockCore::UpdateMemoryBudget()
 {
-    FString FullPath = FPaths::ProjectSavedDir() / Config.CachePath;
-    FString Directory = FPaths::GetPath(FullPath);
-    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-    if (!PlatformFile.DirectoryExists(*Directory))
-    {
-        PlatformFile.CreateDirectoryTree(*Directory);
-    }
-    
-    TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*FullPath));
-    if (!Writer) return;
-    
-    FScopeLock Lock(&StaticMutex);
-    uint32 Magic = LIGHTLOCK_MAGIC;
-    uint32 Version = LIGHTLOCK_VERSION;
-    uint32 Count = StaticCache.size();
-    *Writer << Magic << Version << Count;
+    MemoryBreakdown Breakdown = ComputeMemoryBreakdown();
+    FLightLockMemoryGovernor::FSample Sample;
+    Sample.StaticBytes = Breakdown.StaticBytes;
+    Sample.DynamicBytes = Breakdown.DynamicBytes;
+    Sample.OverheadBytes = Breakdown.OverheadBytes;
+    Sample.StaticEntries = Breakdown.StaticEntries;
+    Sample.DynamicEntries = Breakdown.DynamicEntries;
+    Sample.StaticHits = ReadStat(EStatCounter::StaticHits);
+    Sample.DynamicHits = ReadStat(EStatCounter::DynamicHits);
+    Sample.StaticEvictions = ReadStat(EStatCounter::StaticEvictions);
+    Sample.DynamicEvictions = ReadStat(EStatCounter::DynamicEvictions);
+    Governor->Update(Sample);
     
-    for (const auto& Pair : StaticCache)
+    // The sample sums every resident layer but the limit applies to each, so split it between them.
+    // AdvanceTables trims any excess over the following frames.
+    int32 NumLayers;
     {
-        uint32 Hash = Pair.first;
-        const FLightPath& Path = Pair.second;
-        *Writer << Hash;
-        *Writer << Path.Color.R << Path.Color.G << Path.Color.B << Path.Color.A;
-        *Writer << Path.Weight << Path.BounceCount << Path.Flags << Path.Confidence;
-        *Writer << Path.PositionValidation.X << Path.PositionValidation.Y << Path.PositionValidation.Z;
-        *Writer << Path.NormalValidation.X << Path.NormalValidation.Y << Path.NormalValidation.Z;
-        *Writer << Path.IncidentDirection.X << Path.IncidentDirection.Y << Path.IncidentDirection.Z;
-        *Writer << Path.Roughness;
+        FScopeLock Lock(&StaticMutex);
+        NumLayers = FMath::Max(StaticLayers.Num(), 1);
     }
-    UE_LOG(LogTemp, Log, TEXT("LightLock: Saved %u entries"), Count);
+    StaticCapacityLimit = FMath::Max<int32>(Governor->GetStaticCapacity() / NumLayers, 1);
+    DynamicCapacityLimit = Governor->GetDynamicCapacity();
 }
 
-void FLightLockCore::EvictLowestConfidenceStatic()
+void FLightLockCore::TrimStatic(int32 MaxEvictions)
 {
-    if (StaticCache.empty()) return;
-    auto WorstIt = StaticCache.begin();
-    float LowestConfidence = 1.0f;
-    for (auto It = StaticCache.begin(); It != StaticCache.end(); ++It)
+    FLightLockStaticTable& StaticCache = ActiveStatic->Cache;
+    int32 Batch = FMath::Min(StaticCache.Num() - StaticCapacityLimit.load(), MaxEvictions);
+    if (Batch <= 0) return;
+    LIGHTLOCK_SCOPE_OP(Evict, ETimedOp::Eviction);
+    // Victims are the lowest-confidence entries of a random sample rather than of the whole table, so
+    // each frame's work is bounded; successive batches converge on the table's low end.
+    FMemMark Mark(FMemStack::Get());
+    TArray<TPair<float, uint32>, TMemStackAllocator<>> Candidates;
+    Candidates.Reserve(Batch * TRIM_SAMPLES_PER_EVICTION);
+    StaticCache.ForEachSample(Batch * TRIM_SAMPLES_PER_EVICTION, StaticVictimRandom, [&Candidates](uint32 Hash, const FLightPath& Path)
+    {
+        Candidates.Emplace(Path.Confidence, Hash);
+    });
+    Batch = FMath::Min(Batch, Candidates.Num());
+    if (Batch == 0) return;
+    std::nth_element(Candidates.GetData(), Candidates.GetData() + Batch - 1, Candidates.GetData() + Candidates.Num(),
+        [](const TPair<float, uint32>& A, const TPair<float, uint32>& B) { return A.Key < B.Key; });
+    for (int32 i = 0; i < Batch; ++i)
     {
-        if (It->second.Confidence < LowestConfidence)
+        // Samples can repeat; a duplicate is already gone.
+        if (StaticCache.Remove(Candidates[i].Value))
         {
-            LowestConfidence = It->second.Confidence;
-            WorstIt = It;
+            BumpStat(EStatCounter::StaticEvictions);
         }
     }
-    StaticCache.erase(WorstIt);
 }
 
-void FLightLockCore::EvictLRUOrLowConfidenceDynamic()
+void FLightLockCore::TrimDynamic(int32 MaxEvictions)
 {
-    if (DynamicCache.empty()) return;
-    auto WorstIt = DynamicCache.begin();
-    float WorstScore = FLT_MAX;
+    int32 Batch = static_cast<int32>(FMath::Min<int64>(static_cast<int64>(DynamicCache.Num()) - DynamicCapacityLimit.load(), MaxEvictions));
+    if (Batch <= 0) return;
+    LIGHTLOCK_SCOPE_OP(Evict, ETimedOp::Eviction);
     uint32 CurrentFrameVal = CurrentFrame.load();
-    for (auto It = DynamicCache.begin(); It != DynamicCache.end(); ++It)
+    FMemMark Mark(FMemStack::Get());
+    TArray<TPair<float, uint32>, TMemStackAllocator<>> Candidates;
+    Candidates.Reserve(Batch * TRIM_SAMPLES_PER_EVICTION);
+    DynamicCache.ForEachSample(Batch * TRIM_SAMPLES_PER_EVICTION, DynamicVictimRandom, [&](uint32 Hash, const DynamicEntry& Entry)
     {
-        uint32 Age = CurrentFrameVal - It->second.LastAccessFrame;
-        float Recency = 1.0f / (1.0f + Age);
-        float Score = Recency * It->second.Path.Confidence;
-        if (Score < WorstScore)
+        Candidates.Emplace(GetDynamicRetention(Entry, CurrentFrameVal), Hash);
+    });
+    Batch = FMath::Min(Batch, Candidates.Num());
+    if (Batch == 0) return;
+    std::nth_element(Candidates.GetData(), Candidates.GetData() + Batch - 1, Candidates.GetData() + Candidates.Num(),
+        [](const TPair<float, uint32>& A, const TPair<float, uint32>& B) { return A.Key < B.Key; });
+    for (int32 i = 0; i < Batch; ++i)
+    {
+        uint32 Hash = Candidates[i].Value;
+        if (const DynamicEntry* Found = DynamicCache.Find(Hash))
         {
-            WorstScore = Score;
-            WorstIt = It;
+            SpatialIndex->Remove(Found->WorldPosition, Hash);
+            DynamicCache.Remove(Hash);
+            BumpStat(EStatCounter::DynamicEvictions);
         }
     }
-    FVector Pos = WorstIt->second.WorldPosition;
-    uint32 Hash = WorstIt->first;
-    SpatialIndex->Remove(Pos, Hash);
-    DynamicCache.erase(WorstIt);
 }
 
-void FLightLockCore::PromoteToStatic(uint32 Hash, const FLightPath& Path)
+void FLightLockCore::AdvanceTables()
 {
-    FScopeLock Lock(&StaticMutex);
-    if (StaticCache.size() >= static_cast<size_t>(Config.StaticCapacity))
     {
-        EvictLowestConfidenceStatic();
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        for (auto& Pair : StaticLayers)
+        {
+            Pair.Value->Cache.Tick();
+        }
+        TrimStatic(EVICTIONS_PER_FRAME);
+    }
+    {
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        DynamicCache.Migrate(MIGRATIONS_PER_FRAME);
+        TrimDynamic(EVICTIONS_PER_FRAME);
     }
-    StaticCache[Hash] = Path;
-    Stats.Promotions++;
+}
+
+void FLightLockCore::SetCapacities(int32 StaticCapacity, int32 DynamicCapacity)
+{
+    if (Governor.IsValid())
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Capacities follow the memory budget while one is set; ignoring SetCapacities"));
+        return;
+    }
+    // Growing needs nothing up front: the tables grow incrementally as stores arrive. Shrinking is left
+    // to AdvanceTables, which evicts a bounded batch per frame.
+    StaticCapacityLimit = FMath::Max(StaticCapacity, 1);
+    DynamicCapacityLimit = FMath::Max(DynamicCapacity, 1);
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Capacities set to %d static / %d dynamic"), StaticCapacityLimit.load(), DynamicCapacityLimit.load());
+}
+
+void FLightLockCore::SetWorldSpacePrecision(float Precision)
+{
+    Precision = FMath::Max(Precision, KINDA_SMALL_NUMBER);
+    {
+        FScopeLock Lock(&StaticMutex);
+        if (Config.WorldSpacePrecision == Precision) return;
+        Config.WorldSpacePrecision = Precision;
+        // Static entries keep their position only at 10-unit resolution, so they can't be re-keyed;
+        // resident variants are dropped and refill under the new precision. Loads in flight stop too:
+        // their files were hashed at the old precision.
+        ++LoadGeneration;
+        for (auto& Pair : StaticLayers)
+        {
+            ResetStaticLayer(*Pair.Value);
+        }
+    }
+    {
+        // Dynamic entries have their exact position, and the validation normal is quantized exactly as the
+        // hash quantizes it, so they move to their new hashes a batch per frame.
+        LIGHTLOCK_SCOPE_LOCK(DynamicMutex, ETimedOp::DynamicLockWait);
+        DynamicCache.BeginRekey([this, Precision](uint32 Hash, DynamicEntry& Entry) -> TOptional<uint32>
+        {
+            SpatialIndex->Remove(Entry.WorldPosition, Hash);
+            FVector Normal = FVector(Entry.Path.NormalValidation) / 1000.0f;
+            uint32 NewHash = FLightLockHasher::HashWorldSpace(Entry.WorldPosition, Normal, Precision);
+            // Two entries landing in one new cell keep the first; the other is dropped like an eviction.
+            if (DynamicCache.FindMigrated(NewHash))
+            {
+                BumpStat(EStatCounter::DynamicEvictions);
+                return TOptional<uint32>();
+            }
+            SpatialIndex->Insert(Entry.WorldPosition, NewHash);
+            return NewHash;
+        });
+    }
+    UE_LOG(LogTemp, Log, TEXT("LightLock: World space precision set to %g"), Precision);
+}
+
+float FLightLockCore::GetWorldSpacePrecision() const
+{
+    FScopeLock Lock(&StaticMutex);
+    return Config.WorldSpacePrecision;
+}
+
+void FLightLockCore::BumpStat(EStatCounter Counter, uint64 Amount)
+{
+    StatShards[GetThreadStatShard() % STAT_SHARD_COUNT].Counters[static_cast<int32>(Counter)].fetch_add(Amount, std::memory_order_relaxed);
+}
+
+uint64 FLightLockCore::ReadStat(EStatCounter Counter) const
+{
+    uint64 Total = 0;
+    for (const StatShard& Shard : StatShards)
+    {
+        Total += Shard.Counters[static_cast<int32>(Counter)].load(std::memory_order_relaxed);
+    }
+    return Total;
+}
+
+#if LIGHTLOCK_ENABLE_INSTRUMENTATION
+void FLightLockCore::RecordLatency(ETimedOp Op, uint64 Cycles) const
+{
+    static const double NanosecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1.0e9;
+    uint64 Nanoseconds = static_cast<uint64>(static_cast<double>(Cycles) * NanosecondsPerCycle);
+    int32 Bucket = Nanoseconds > 0 ? FMath::Min<int32>(FMath::FloorLog2_64(Nanoseconds), LATENCY_BUCKETS - 1) : 0;
+    
+    LatencyShard& Shard = LatencyShards[GetThreadStatShard() % STAT_SHARD_COUNT];
+    Shard.Buckets[static_cast<int32>(Op)][Bucket].fetch_add(1, std::memory_order_relaxed);
+    std::atomic<uint64>& Max = Shard.MaxNanoseconds[static_cast<int32>(Op)];
+    uint64 PrevMax = Max.load(std::memory_order_relaxed);
+    while (Nanoseconds > PrevMax && !Max.compare_exchange_weak(PrevMax, Nanoseconds, std::memory_order_relaxed)) {}
+}
+
+FLightLockLatency FLightLockCore::ReadLatency(ETimedOp Op) const
+{
+    uint64 Buckets[LATENCY_BUCKETS] = {};
+    uint64 Total = 0;
+    uint64 MaxNanoseconds = 0;
+    for (const LatencyShard& Shard : LatencyShards)
+    {
+        for (int32 i = 0; i < LATENCY_BUCKETS; ++i)
+        {
+            uint64 Count = Shard.Buckets[static_cast<int32>(Op)][i].load(std::memory_order_relaxed);
+            Buckets[i] += Count;
+            Total += Count;
+        }
+        MaxNanoseconds = FMath::Max(MaxNanoseconds, Shard.MaxNanoseconds[static_cast<int32>(Op)].load(std::memory_order_relaxed));
+    }
+    
+    FLightLockLatency Result;
+    Result.Count = static_cast<int64>(Total);
+    Result.MaxMicroseconds = MaxNanoseconds / 1000.0f;
+    if (Total == 0) return Result;
+    
+    // Buckets are log2-spaced in nanoseconds; report each percentile as its bucket's upper edge.
+    auto Percentile = [&](double Fraction)
+    {
+        uint64 Target = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(Total * Fraction)));
+        uint64 Seen = 0;
+        for (int32 i = 0; i < LATENCY_BUCKETS; ++i)
+        {
+            Seen += Buckets[i];
+            if (Seen >= Target)
+            {
+                return FMath::Min((2ull << i) / 1000.0f, Result.MaxMicroseconds);
+            }
+        }
+        return Result.MaxMicroseconds;
+    };
+    Result.P50Microseconds = Percentile(0.50);
+    Result.P99Microseconds = Percentile(0.99);
+    return Result;
+}
+
+void FLightLockCore::PublishFrameStats() const
+{
+    bool bWanted = false;
+#if CSV_PROFILER
+    bWanted |= FCsvProfiler::Get()->IsCapturing();
+#endif
+#if STATS
+    bWanted |= FThreadStats::IsCollectingData();
+#endif
+    if (!bWanted) return;
+    
+    FLightLockStats Snapshot = GetStats();
+    SET_DWORD_STAT(STAT_LightLock_StaticEntries, Snapshot.StaticCount);
+    SET_DWORD_STAT(STAT_LightLock_DynamicEntries, Snapshot.DynamicCount);
+    SET_FLOAT_STAT(STAT_LightLock_HitRate, Snapshot.HitRate);
+    SET_FLOAT_STAT(STAT_LightLock_QueryP99, Snapshot.QueryLatency.P99Microseconds);
+    CSV_CUSTOM_STAT(LightLock, StaticEntries, static_cast<int32>(Snapshot.StaticCount), ECsvCustomStatOp::Set);
+    CSV_CUSTOM_STAT(LightLock, DynamicEntries, static_cast<int32>(Snapshot.DynamicCount), ECsvCustomStatOp::Set);
+    CSV_CUSTOM_STAT(LightLock, HitRate, Snapshot.HitRate, ECsvCustomStatOp::Set);
+    CSV_CUSTOM_STAT(LightLock, QueryP99Us, Snapshot.QueryLatency.P99Microseconds, ECsvCustomStatOp::Set);
+    CSV_CUSTOM_STAT(LightLock, StaticLockWaitP99Us, Snapshot.StaticLockWait.P99Microseconds, ECsvCustomStatOp::Set);
+    CSV_CUSTOM_STAT(LightLock, DynamicLockWaitP99Us, Snapshot.DynamicLockWait.P99Microseconds, ECsvCustomStatOp::Set);
+}
+#endif
+
+void FLightLockCore::Load(StaticLayer& Layer)
+{
+    TSharedPtr<FStaticLoad> Pending = OpenLoad(Layer);
+    if (!Pending.IsValid()) return;
+    // The hot set is small, so it loads before returning and the first frames already hit; the rest streams in.
+    LoadHotSet(*Pending);
+    if (Config.bEnableAsyncLoading)
+    {
+        FScopeLock Lock(&LoadMutex);
+        LoadTasks.RemoveAll([](const TFuture<void>& Task) { return Task.IsReady(); });
+        LoadTasks.Add(Async(EAsyncExecution::ThreadPool, [this, Pending]() { LoadRemaining(*Pending); }));
+    }
+    else
+    {
+        LoadRemaining(*Pending);
+    }
+}
+
+void FLightLockCore::WaitForLoads()
+{
+    TArray<TFuture<void>> Pending;
+    {
+        FScopeLock Lock(&LoadMutex);
+        Pending = MoveTemp(LoadTasks);
+    }
+    for (TFuture<void>& Task : Pending)
+    {
+        Task.Wait();
+    }
+}
+
+FString FLightLockCore::GetCacheFilePath(const FLightLockEnvironmentKey& Key) const
+{
+    FString FullPath = FPaths::ProjectSavedDir() / Config.CachePath;
+    if (Key.IsDefault()) return FullPath;
+    return FPaths::GetPath(FullPath) / FString::Printf(TEXT("%s_%08x_%08x.%s"),
+        *FPaths::GetBaseFilename(FullPath), Key.TimeOfDayBucket, Key.LightSetHash, *FPaths::GetExtension(FullPath));
+}
+
+struct FLightLockCore::FStaticLoad
+{
+    StaticLayer* Layer = nullptr;
+    FString FilePath;
+    FLightLockCacheFileReader Reader;
+    TArray<FLightLockCacheTile> Tiles;
+    FLightLockLoadHints Hints;
+    // Entries already read, so the tile pass skips the hot set.
+    TBitArray<> Loaded;
+    int32 NumAdded = 0;
+    // LoadGeneration when the load started; see AddLoadedBatch.
+    uint32 Generation = 0;
+    bool bFull = false;
+    bool bCancelled = false;
+};
+
+TSharedPtr<FLightLockCore::FStaticLoad> FLightLockCore::OpenLoad(StaticLayer& Layer)
+{
+    TSharedPtr<FStaticLoad> Load = MakeShared<FStaticLoad>();
+    Load->Layer = &Layer;
+    Load->Generation = LoadGeneration.load();
+    Load->FilePath = GetCacheFilePath(Layer.Key);
+    if (!Load->Reader.Open(Load->FilePath)) return nullptr;
+    if (Load->Reader.GetEnvironment() != Layer.Key)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: %s was captured for a different lighting environment"), *Load->FilePath);
+        return nullptr;
+    }
+    // A damaged trailer only costs the ordering: reopen (archive errors are sticky) and load in file order.
+    if (!Load->Reader.ReadTiles(Load->Tiles) || !Load->Reader.ReadLoadHints(Load->Hints))
+    {
+        Load->Tiles.Reset();
+        Load->Hints = FLightLockLoadHints();
+        if (!Load->Reader.Open(Load->FilePath)) return nullptr;
+    }
+    Load->Loaded.Init(false, Load->Reader.GetCount());
+    return Load;
+}
+
+bool FLightLockCore::AddLoadedBatch(FStaticLoad& Load, TArray<FLightLockCacheEntry>& Batch)
+{
+    // One lock per batch, so queries interleave with a long load instead of waiting for all of it.
+    FScopeLock Lock(&StaticMutex);
+    // Checked under the same lock the layers are cleared under, so nothing from before a clear gets in after it.
+    if (Load.Generation != LoadGeneration.load())
+    {
+        Load.bCancelled = true;
+        Batch.Reset();
+        return false;
+    }
+    FLightLockStaticTable& StaticCache = Load.Layer->Cache;
+    int32 Capacity = StaticCapacityLimit.load();
+    for (const FLightLockCacheEntry& Entry : Batch)
+    {
+        if (StaticCache.Num() >= Capacity)
+        {
+            Load.bFull = true;
+            break;
+        }
+        // Entries stored since startup are newer than the file's copy.
+        if (StaticCache.Find(Entry.Hash)) continue;
+        StaticCache.Add(Entry.Hash, Entry.Path);
+        Load.NumAdded++;
+    }
+    Batch.Reset();
+    return !Load.bFull;
+}
+
+void FLightLockCore::LoadHotSet(FStaticLoad& Load)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_LoadHotSet);
+    FLightLockCacheFileReader& Reader = Load.Reader;
+    TArray<uint32> Indices = Load.Hints.HotEntries;
+    // Keep the hottest if they don't all fit, then read in file order so neighbours share a seek.
+    Indices.SetNum(FMath::Min(Indices.Num(), StaticCapacityLimit.load()));
+    Indices.Sort();
+    TArray<FLightLockCacheEntry> Batch;
+    Batch.Reserve(FMath::Min(Indices.Num(), LOAD_BATCH_ENTRIES));
+    FLightLockCacheEntry Entry;
+    for (uint32 EntryIndex : Indices)
+    {
+        if (EntryIndex >= Reader.GetCount() || Load.Loaded[EntryIndex]) continue;
+        if (!Reader.SeekToEntry(EntryIndex) || !Reader.Next(Entry)) break;
+        Load.Loaded[EntryIndex] = true;
+        Batch.Add(Entry);
+        if (Batch.Num() == LOAD_BATCH_ENTRIES && !AddLoadedBatch(Load, Batch)) return;
+    }
+    AddLoadedBatch(Load, Batch);
+}
+
+void FLightLockCore::LoadRemaining(FStaticLoad& Load)
+{
+    SCOPE_CYCLE_COUNTER(STAT_LightLock_Load);
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_Load);
+    FLightLockCacheFileReader& Reader = Load.Reader;
+    uint32 Count = Reader.GetCount();
+    TArray<FLightLockCacheEntry> Batch;
+    Batch.Reserve(LOAD_BATCH_ENTRIES);
+    auto ReadRange = [&](uint32 First, uint32 End)
+    {
+        if (Load.bFull || Load.bCancelled || !Reader.SeekToEntry(First)) return false;
+        FLightLockCacheEntry Entry;
+        for (uint32 EntryIndex = First; EntryIndex < End; ++EntryIndex)
+        {
+            if (!Reader.Next(Entry)) return false;
+            if (Load.Loaded[EntryIndex]) continue;
+            Load.Loaded[EntryIndex] = true;
+            Batch.Add(Entry);
+            if (Batch.Num() == LOAD_BATCH_ENTRIES && !AddLoadedBatch(Load, Batch)) return false;
+        }
+        return true;
+    };
+    
+    const TArray<FLightLockCacheTile>& Tiles = Load.Tiles;
+    if (Tiles.Num() == 0)
+    {
+        ReadRange(0, Count);
+    }
+    else
+    {
+        // Nearest tile to the focus first: the live camera or load focus if one has arrived, else the
+        // camera recorded at save time. Re-sorted when the focus moves by a tile, so a spawn point that
+        // arrives mid-load redirects the rest of it.
+        const double TileSize = 100.0 * (1 << (FLightLockCacheFileWriter::TILE_SHIFT / 3));
+        TArray<FVector> Centers;
+        Centers.Reserve(Tiles.Num());
+        for (const FLightLockCacheTile& Tile : Tiles)
+        {
+            Centers.Add(FLightLockHasher::MortonDecode(Tile.TileKey << FLightLockCacheFileWriter::TILE_SHIFT) + FVector(TileSize * 0.5));
+        }
+        TArray<int32> Order;
+        Order.Reserve(Tiles.Num());
+        for (int32 i = Tiles.Num() - 1; i >= 0; --i)
+        {
+            Order.Add(i);
+        }
+        bool bSorted = false;
+        FVector SortedFocus = FVector::ZeroVector;
+        while (Order.Num() > 0)
+        {
+            FVector Focus = Load.Hints.CameraPosition;
+            bool bHasFocus = Load.Hints.bHasCamera;
+            {
+                FScopeLock Lock(&StaticMutex);
+                if (bHasLoadFocus)
+                {
+                    Focus = LoadFocus;
+                    bHasFocus = true;
+                }
+            }
+            if (bHasFocus && (!bSorted || FVector::Dist(Focus, SortedFocus) > TileSize))
+            {
+                // Farthest first, so the nearest tile pops off the end.
+                Algo::SortBy(Order, [&Centers, &Focus](int32 i) { return -FVector::DistSquared(Centers[i], Focus); });
+                bSorted = true;
+                SortedFocus = Focus;
+            }
+            int32 TileIndex = Order.Pop();
+            uint32 End = TileIndex + 1 < Tiles.Num() ? Tiles[TileIndex + 1].FirstEntry : Count;
+            if (!ReadRange(Tiles[TileIndex].FirstEntry, End)) break;
+        }
+    }
+    if (Batch.Num() > 0)
+    {
+        AddLoadedBatch(Load, Batch);
+    }
+    
+    FLightLockStaticTable::FSnapshot Published;
+    bool bPublish = false;
+    int32 Loaded = 0;
+    {
+        FScopeLock Lock(&StaticMutex);
+        if (Load.bCancelled || Load.Generation != LoadGeneration.load())
+        {
+            UE_LOG(LogTemp, Log, TEXT("LightLock: Cancelled loading %s after %d entries"), *Load.FilePath, Load.NumAdded);
+            return;
+        }
+        FLightLockStaticTable& StaticCache = Load.Layer->Cache;
+        // Folds the loaded delta into the packed base on the thread pool.
+        StaticCache.Tick();
+        Loaded = StaticCache.Num();
+        bPublish = IsSharedLayer(*Load.Layer) && SharedCache->IsOwner();
+        if (bPublish) Published = StaticCache.Snapshot();
+    }
+    if (bPublish)
+    {
+        PublishShared(Published);
+    }
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Loaded %d entries (%d from %s)"), Loaded, Load.NumAdded, *Load.FilePath);
+}
+
+void FLightLockCore::Save()
+{
+    LIGHTLOCK_SCOPE_OP(Save, ETimedOp::Save);
+    // One layer per lock acquisition, so a query waits for at most one layer's snapshot.
+    TArray<FLightLockEnvironmentKey> Keys;
+    {
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        StaticLayers.GetKeys(Keys);
+    }
+    for (const FLightLockEnvironmentKey& Key : Keys)
+    {
+        LIGHTLOCK_SCOPE_LOCK(StaticMutex, ETimedOp::StaticLockWait);
+        if (TUniquePtr<StaticLayer>* Layer = StaticLayers.Find(Key))
+        {
+            SaveLayer(**Layer);
+        }
+    }
+}
+
+void FLightLockCore::WaitForSaves() const
+{
+    TArray<TFuture<void>> Pending;
+    {
+        FScopeLock Lock(&SaveMutex);
+        Pending = MoveTemp(SaveTasks);
+    }
+    for (TFuture<void>& Task : Pending)
+    {
+        Task.Wait();
+    }
+}
+
+bool FLightLockCore::WriteCacheFile(const FString& FilePath, const FLightLockEnvironmentKey& Environment, TArrayView<const FLightLockCacheEntry> Entries)
+{
+    FLightLockCacheFileWriter Writer;
+    if (!Writer.Open(FilePath, Environment)) return false;
+    for (const FLightLockCacheEntry& Entry : Entries)
+    {
+        Writer.Write(Entry);
+    }
+    return Writer.Close();
+}
+
+bool FLightLockCore::ReadCacheFile(const FString& FilePath, FLightLockEnvironmentKey& OutEnvironment, TArray<FLightLockCacheEntry>& OutEntries)
+{
+    FLightLockCacheFileReader Reader;
+    if (!Reader.Open(FilePath)) return false;
+    
+    OutEnvironment = Reader.GetEnvironment();
+    OutEntries.Reset(Reader.GetCount());
+    FLightLockCacheEntry Entry;
+    while (Reader.Next(Entry))
+    {
+        OutEntries.Add(Entry);
+    }
+    return OutEntries.Num() == static_cast<int32>(Reader.GetCount());
+}
+
+bool FLightLockCacheFileReader::Open(const FString& FilePath)
+{
+    Reader.Reset(IFileManager::Get().CreateFileReader(*FilePath));
+    NumRead = 0;
+    Count = 0;
+    if (!Reader) return false;
+    if (!SerializeCacheHeader(*Reader, Version, Environment, Count))
+    {
+        Reader.Reset();
+        return false;
+    }
+    EntriesOffset = Reader->Tell();
+    return true;
+}
+
+bool FLightLockCacheFileReader::Next(FLightLockCacheEntry& OutEntry)
+{
+    if (!Reader || NumRead >= Count) return false;
+    SerializeCacheEntry(*Reader, OutEntry.Hash, OutEntry.Path);
+    if (Reader->IsError())
+    {
+        Reader.Reset();
+        return false;
+    }
+    NumRead++;
+    return true;
+}
+
+bool FLightLockCacheFileReader::SeekToEntry(uint32 EntryIndex)
+{
+    if (!Reader || EntryIndex > Count) return false;
+    Reader->Seek(EntriesOffset + EntryIndex * FLightLockCacheFileWriter::ENTRY_BYTES);
+    NumRead = EntryIndex;
+    return !Reader->IsError();
+}
+
+bool FLightLockCacheFileReader::ReadTiles(TArray<FLightLockCacheTile>& OutTiles)
+{
+    OutTiles.Reset();
+    if (!Reader) return false;
+    if (Version < LIGHTLOCK_VERSION_NO_HINTS) return true;
+    
+    Reader->Seek(EntriesOffset + Count * FLightLockCacheFileWriter::ENTRY_BYTES);
+    uint32 NumTiles = 0;
+    *Reader << NumTiles;
+    if (Reader->IsError() || NumTiles > Count) return false;
+    OutTiles.SetNum(NumTiles);
+    for (FLightLockCacheTile& Tile : OutTiles)
+    {
+        *Reader << Tile.TileKey << Tile.FirstEntry;
+    }
+    bool bOk = !Reader->IsError();
+    return SeekToEntry(NumRead) && bOk;
+}
+
+bool FLightLockCacheFileReader::ReadLoadHints(FLightLockLoadHints& OutHints)
+{
+    OutHints = FLightLockLoadHints();
+    if (!Reader) return false;
+    if (Version < LIGHTLOCK_VERSION) return true;
+    
+    Reader->Seek(EntriesOffset + Count * FLightLockCacheFileWriter::ENTRY_BYTES);
+    uint32 NumTiles = 0;
+    *Reader << NumTiles;
+    if (Reader->IsError() || NumTiles > Count) return false;
+    Reader->Seek(Reader->Tell() + NumTiles * static_cast<int64>(sizeof(uint64) + sizeof(uint32)));
+    uint8 bHasCamera = 0;
+    uint32 NumHot = 0;
+    *Reader << bHasCamera << OutHints.CameraPosition.X << OutHints.CameraPosition.Y << OutHints.CameraPosition.Z << NumHot;
+    if (Reader->IsError() || NumHot > Count) return false;
+    OutHints.bHasCamera = bHasCamera != 0;
+    OutHints.HotEntries.SetNum(NumHot);
+    for (uint32& EntryIndex : OutHints.HotEntries)
+    {
+        *Reader << EntryIndex;
+    }
+    bool bOk = !Reader->IsError();
+    return SeekToEntry(NumRead) && bOk;
+}
+
+FLightLockCacheFileWriter::~FLightLockCacheFileWriter()
+{
+    if (Writer)
+    {
+        Writer.Reset();
+        IFileManager::Get().Delete(*TempPath, false, true, true);
+    }
+}
+
+bool FLightLockCacheFileWriter::Open(const FString& FilePath, const FLightLockEnvironmentKey& InEnvironment)
+{
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(FilePath), true);
+    TargetPath = FilePath;
+    TempPath = FilePath + TEXT(".tmp");
+    Writer.Reset(IFileManager::Get().CreateFileWriter(*TempPath));
+    if (!Writer) return false;
+    
+    Environment = InEnvironment;
+    Count = 0;
+    Tiles.Reset();
+    LastCode = 0;
+    bMortonOrdered = true;
+    HotRanks.Reset();
+    HotEntries.Reset();
+    bHasCamera = false;
+    uint32 Version = LIGHTLOCK_VERSION;
+    SerializeCacheHeader(*Writer, Version, Environment, Count);
+    return !Writer->IsError();
+}
+
+void FLightLockCacheFileWriter::SetHotSet(TArrayView<const uint32> HotHashes)
+{
+    HotRanks.Reset();
+    HotRanks.Reserve(HotHashes.Num());
+    for (int32 i = 0; i < HotHashes.Num(); ++i)
+    {
+        HotRanks.Add(HotHashes[i], i);
+    }
+}
+
+void FLightLockCacheFileWriter::SetCamera(const FVector& CameraPosition)
+{
+    bHasCamera = true;
+    Camera = CameraPosition;
+}
+
+void FLightLockCacheFileWriter::Write(const FLightLockCacheEntry& Entry)
+{
+    if (HotRanks.Num() > 0)
+    {
+        if (const int32* Rank = HotRanks.Find(Entry.Hash))
+        {
+            HotEntries.Emplace(*Rank, Count);
+        }
+    }
+    uint64 Code = FLightLockStaticTable::GetMortonCode(Entry.Path);
+    bMortonOrdered &= Count == 0 || Code >= LastCode;
+    uint64 TileKey = Code >> TILE_SHIFT;
+    if (bMortonOrdered && (Tiles.Num() == 0 || Tiles.Last().TileKey != TileKey))
+    {
+        FLightLockCacheTile& Tile = Tiles.AddDefaulted_GetRef();
+        Tile.TileKey = TileKey;
+        Tile.FirstEntry = Count;
+    }
+    LastCode = Code;
+    
+    uint32 Hash = Entry.Hash;
+    FLightPath Path = Entry.Path;
+    SerializeCacheEntry(*Writer, Hash, Path);
+    Count++;
+}
+
+bool FLightLockCacheFileWriter::Close()
+{
+    if (!Writer) return false;
+    uint32 NumTiles = bMortonOrdered ? Tiles.Num() : 0;
+    *Writer << NumTiles;
+    for (uint32 i = 0; i < NumTiles; ++i)
+    {
+        *Writer << Tiles[i].TileKey << Tiles[i].FirstEntry;
+    }
+    HotEntries.Sort([](const TPair<int32, uint32>& A, const TPair<int32, uint32>& B) { return A.Key < B.Key; });
+    uint8 bCamera = bHasCamera ? 1 : 0;
+    uint32 NumHot = HotEntries.Num();
+    *Writer << bCamera << Camera.X << Camera.Y << Camera.Z << NumHot;
+    for (TPair<int32, uint32>& Hot : HotEntries)
+    {
+        *Writer << Hot.Value;
+    }
+    // The count is the last header field, so rewrite the header in place once it is known.
+    uint32 Version = LIGHTLOCK_VERSION;
+    uint32 FinalCount = Count;
+    Writer->Seek(0);
+    SerializeCacheHeader(*Writer, Version, Environment, FinalCount);
+    bool bOk = Writer->Close();
+    Writer.Reset();
+    if (!bOk)
+    {
+        IFileManager::Get().Delete(*TempPath, false, true, true);
+        return false;
+    }
+    // Same-directory rename, so readers see either the old file or the complete new one.
+    return IFileManager::Get().Move(*TargetPath, *TempPath, true, true);
+}
+
+bool FLightLockCore::IsSharedLayer(const StaticLayer& Layer) const
+{
+    return SharedCache.IsValid() && Layer.Key == SharedCache->GetEnvironment();
+}
+
+void FLightLockCore::PublishShared(const FLightLockStaticTable::FSnapshot& Snapshot) const
+{
+    FScopeLock Lock(&PublishMutex);
+    SharedCache->BeginPublish();
+    int32 Dropped = 0;
+    Snapshot.ForEach([this, &Dropped](uint32 Hash, const FLightPath& Path)
+    {
+        if (!SharedCache->Publish(Hash, Path)) Dropped++;
+    });
+    SharedCache->EndPublish();
+    if (Dropped > 0)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Shared cache is full, %d static entries not published (it holds StaticCapacity records)"), Dropped);
+    }
+}
+
+void FLightLockCore::SaveLayer(StaticLayer& Layer)
+{
+    // Readers of a shared static layer never loaded the file, so they must not overwrite it.
+    if (Layer.bSharedReadOnly) return;
+    
+    // Only the snapshots happen under StaticMutex, and both share rather than copy; serializing and
+    // writing run on the thread pool.
+    FString FilePath = GetCacheFilePath(Layer.Key);
+    bool bPublish = IsSharedLayer(Layer);
+    uint64 Generation = ++SaveGeneration;
+    FSaveHints Hints;
+    Hints.Access = Layer.Access.Snapshot();
+    Hints.Frame = CurrentFrame.load();
+    Hints.bHasCamera = bHasLoadFocus;
+    Hints.Camera = LoadFocus;
+    FScopeLock Lock(&SaveMutex);
+    SaveTasks.RemoveAll([](const TFuture<void>& Task) { return Task.IsReady(); });
+    SaveTasks.Add(Async(EAsyncExecution::ThreadPool,
+        [this, FilePath, Key = Layer.Key, Snapshot = Layer.Cache.Snapshot(), Hints = MoveTemp(Hints), Generation, bPublish]() mutable
+        {
+            WriteSnapshot(FilePath, Key, Snapshot, Hints, Generation, bPublish);
+        }));
+}
+
+void FLightLockCore::WriteSnapshot(const FString& FilePath, const FLightLockEnvironmentKey& Key, const FLightLockStaticTable::FSnapshot& Snapshot, FSaveHints& Hints, uint64 Generation, bool bPublish) const
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(LightLock_WriteSnapshot);
+    TArray<uint32> HotSet;
+    Hints.Access.GetHotSet(Hints.Frame, HotSet);
+    // Let go of the tracker's slots so its next hit doesn't have to copy them.
+    Hints.Access = FLightLockAccessTracker::FSnapshot();
+    FScopeLock Lock(&WriteMutex);
+    // Writes can finish out of order on the pool; never replace a file with an older snapshot.
+    uint64& Written = WrittenGenerations.FindOrAdd(FilePath);
+    if (Written > Generation) return;
+    Written = Generation;
+    
+    // The writer goes through a temp file and a rename, so a crash mid-write leaves the previous file intact.
+    FLightLockCacheFileWriter Writer;
+    if (!Writer.Open(FilePath, Key)) return;
+    Writer.SetHotSet(HotSet);
+    if (Hints.bHasCamera) Writer.SetCamera(Hints.Camera);
+    // The table iterates in Morton order, so the file gets the same locality and a tile directory.
+    Snapshot.ForEach([&Writer](uint32 Hash, const FLightPath& Path)
+    {
+        FLightLockCacheEntry Entry;
+        Entry.Hash = Hash;
+        Entry.Path = Path;
+        Writer.Write(Entry);
+    });
+    uint32 Count = Writer.GetCount();
+    if (!Writer.Close())
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Failed to write %s"), *FilePath);
+        return;
+    }
+    if (bPublish && SharedCache->IsOwner())
+    {
+        PublishShared(Snapshot);
+    }
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Saved %u entries"), Count);
+}
+
+FLightLockCore::StaticLayer::StaticLayer(const FLightLockEnvironmentKey& InKey)
+    : Key(InKey)
+{
+}
+
+FLightLockCore::StaticLayer* FLightLockCore::AddStaticLayer(const FLightLockEnvironmentKey& Key)
+{
+    return StaticLayers.Add(Key, MakeUnique<StaticLayer>(Key)).Get();
+}
+
+void FLightLockCore::EvictIdleStaticLayers(int32 MaxLayers)
+{
+    // Caller has waited for pending loads; layers still loading would otherwise be destroyed under the loader.
+    FScopeLock Lock(&StaticMutex);
+    while (StaticLayers.Num() > FMath::Max(MaxLayers, 1))
+    {
+        StaticLayer* Oldest = nullptr;
+        for (const auto& Pair : StaticLayers)
+        {
+            StaticLayer* Layer = Pair.Value.Get();
+            if (Layer == ActiveStatic || Layer == BlendStatic) continue;
+            if (!Oldest || Layer->LastActiveFrame < Oldest->LastActiveFrame)
+            {
+                Oldest = Layer;
+            }
+        }
+        if (!Oldest) return;
+        SaveLayer(*Oldest);
+        StaticLayers.Remove(Oldest->Key);
+    }
+}
+
+void FLightLockCore::SetEnvironment(const FLightLockEnvironmentKey& Key, const FLightLockEnvironmentKey& BlendKey, float InBlendAlpha)
+{
+    StaticLayer* NewLayer = nullptr;
+    bool bChanged = false;
+    {
+        FScopeLock Lock(&StaticMutex);
+        if (TUniquePtr<StaticLayer>* Existing = StaticLayers.Find(Key))
+        {
+            NewLayer = Existing->Get();
+        }
+        bChanged = ActiveStatic->Key != Key;
+        if (NewLayer)
+        {
+            ActiveStatic->LastActiveFrame = CurrentFrame.load();
+            ActiveStatic = NewLayer;
+            TUniquePtr<StaticLayer>* Blend = InBlendAlpha > 0.0f && BlendKey != Key ? StaticLayers.Find(BlendKey) : nullptr;
+            BlendStatic = Blend ? Blend->Get() : nullptr;
+            BlendAlpha = FMath::Clamp(InBlendAlpha, 0.0f, 1.0f);
+        }
+    }
+    if (!NewLayer)
+    {
+        PreloadEnvironment(Key);
+        SetEnvironment(Key, BlendKey, InBlendAlpha);
+        return;
+    }
+    if (bChanged)
+    {
+        // Dynamic entries were captured under the previous lighting; static variants carry over.
+        ClearDynamic();
+        UE_LOG(LogTemp, Log, TEXT("LightLock: Switched to environment %d/%08x"), Key.TimeOfDayBucket, Key.LightSetHash);
+    }
+}
+
+void FLightLockCore::PreloadEnvironment(const FLightLockEnvironmentKey& Key)
+{
+    bool bAtLimit = false;
+    {
+        FScopeLock Lock(&StaticMutex);
+        if (StaticLayers.Contains(Key)) return;
+        bAtLimit = StaticLayers.Num() >= Config.MaxResidentEnvironments;
+    }
+    if (bAtLimit)
+    {
+        WaitForLoads();
+        EvictIdleStaticLayers(Config.MaxResidentEnvironments - 1);
+    }
+    StaticLayer* Layer = nullptr;
+    {
+        FScopeLock Lock(&StaticMutex);
+        Layer = AddStaticLayer(Key);
+    }
+    Load(*Layer);
+}
+
+void FLightLockCore::ReleaseEnvironment(const FLightLockEnvironmentKey& Key)
+{
+    WaitForLoads();
+    FScopeLock Lock(&StaticMutex);
+    TUniquePtr<StaticLayer>* Existing = StaticLayers.Find(Key);
+    if (!Existing || Existing->Get() == ActiveStatic) return;
+    if (Existing->Get() == BlendStatic)
+    {
+        BlendStatic = nullptr;
+        BlendAlpha = 0.0f;
+    }
+    SaveLayer(**Existing);
+    StaticLayers.Remove(Key);
+}
+
+FLightLockEnvironmentKey FLightLockCore::GetEnvironment() const
+{
+    FScopeLock Lock(&StaticMutex);
+    return ActiveStatic->Key;
+}
+
+bool FLightLockCore::FindStaticVictim(uint32& OutHash)
+{
+    // Runs on every store at capacity, so it samples instead of scanning: the lowest confidence of
+    // STATIC_VICTIM_SAMPLES random entries is almost always among the table's lowest few percent.
+    float LowestConfidence = FLT_MAX;
+    ActiveStatic->Cache.ForEachSample(STATIC_VICTIM_SAMPLES, StaticVictimRandom, [&](uint32 Hash, const FLightPath& Path)
+    {
+        if (Path.Confidence < LowestConfidence)
+        {
+            LowestConfidence = Path.Confidence;
+            OutHash = Hash;
+        }
+    });
+    return LowestConfidence != FLT_MAX;
+}
+
+bool FLightLockCore::FindDynamicVictim(uint32& OutHash)
+{
+    // Sampled like FindStaticVictim: it runs on every store into a full table.
+    float WorstScore = FLT_MAX;
+    uint32 CurrentFrameVal = CurrentFrame.load();
+    DynamicCache.ForEachSample(DYNAMIC_VICTIM_SAMPLES, DynamicVictimRandom, [&](uint32 Hash, const DynamicEntry& Entry)
+    {
+        float Score = GetDynamicRetention(Entry, CurrentFrameVal);
+        if (Score < WorstScore)
+        {
+            WorstScore = Score;
+            OutHash = Hash;
+        }
+    });
+    return WorstScore != FLT_MAX;
+}
+
+float FLightLockCore::GetDynamicRetention(const DynamicEntry& Entry, uint32 Frame) const
+{
+    uint32 Age = Frame - Entry.LastAccessFrame;
+    if (Config.ConfidenceHalfLifeFrames > 0)
+    {
+        // Confidence halves every ConfidenceHalfLifeFrames without a hit.
+        return Entry.Path.Confidence * FMath::Exp2(-static_cast<float>(Age) / Config.ConfidenceHalfLifeFrames);
+    }
+    return Entry.Path.Confidence / (1.0f + Age);
+}
+
+void FLightLockCore::EvictStatic(uint32 Hash)
+{
+    LIGHTLOCK_SCOPE_OP(Evict, ETimedOp::Eviction);
+    BumpStat(EStatCounter::StaticEvictions);
+    ActiveStatic->Cache.Remove(Hash);
+}
+
+void FLightLockCore::EvictDynamic(uint32 Hash)
+{
+    LIGHTLOCK_SCOPE_OP(Evict, ETimedOp::Eviction);
+    BumpStat(EStatCounter::DynamicEvictions);
+    const DynamicEntry* Found = DynamicCache.Find(Hash);
+    if (!Found) return;
+    SpatialIndex->Remove(Found->WorldPosition, Hash);
+    DynamicCache.Remove(Hash);
+}
+
+void FLightLockCore::PromoteToStatic(uint32 Hash, const FLightPath& Path)
+{
+    FScopeLock Lock(&StaticMutex);
+    StoreStatic(Hash, Path);
+    BumpStat(EStatCounter::Promotions);
+}
+
+bool FLightLockCore::TouchDynamic(DynamicEntry& Entry, uint32 Frame) const
+{
+    // Age since the previous hit, taken before this hit refreshes it.
+    uint32 Age = Frame - Entry.LastAccessFrame;
+    Entry.LastAccessFrame = Frame;
+    return Age > static_cast<uint32>(Config.PromotionFrameThreshold);
 }
 
 FLinearColor FLightLockCore::ApplyTemporalSmoothing(uint32 Hash, const FLinearColor& NewColor, bool bIsMiss)
 {
-    FLinearColor* PrevColor = PreviousColors.Find(Hash);
+    SmoothingShard& Shard = SmoothingShards[Hash % SMOOTHING_SHARD_COUNT];
+    FScopeLock Lock(&Shard.Mutex);
+    FLinearColor* PrevColor = Shard.PreviousColors.Find(Hash);
     if (bIsMiss && PrevColor) return *PrevColor;
     if (!PrevColor)
     {
-        PreviousColors.Add(Hash, NewColor);
+        Shard.PreviousColors.Add(Hash, NewColor);
         return NewColor;
     }
     FLinearColor Smoothed = FMath::Lerp(*PrevColor, NewColor, 0.1f);
-    PreviousColors.Add(Hash, Smoothed);
+    *PrevColor = Smoothed;
     return Smoothed;
 }
@@ -0,0 +1,145 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockDelta.h"
+#include "LightLockEncoding.h"
+#include "Algo/Sort.h"
+#include "Math/Float16.h"
+#include "Misc/Compression.h"
+
+static constexpr uint32 LIGHTLOCK_DELTA_MAGIC = 0x4C4C444C;
+static constexpr uint32 LIGHTLOCK_DELTA_VERSION = 1;
+static constexpr uint8 DELTA_FLAG_COMPRESSED = 0x01;
+// Bounds of one packed entry and of a whole delta, checked before allocating anything the header asks for.
+static constexpr int64 DELTA_MIN_ENTRY_BYTES = 24;
+static constexpr int64 DELTA_MAX_ENTRY_BYTES = 64;
+static constexpr int64 DELTA_MAX_PACKED_BYTES = 256 * 1024 * 1024;
+// zlib can't expand data by more than about 1000:1.
+static constexpr int64 DELTA_MAX_COMPRESSION_RATIO = 1032;
+
+using namespace LightLockEncoding;
+
+void FLightLockDeltaCodec::Encode(const FLightLockDeltaHeader& Header, TArray<FLightLockCacheEntry>& Entries, TArray<uint8>& OutBytes)
+{
+    Algo::SortBy(Entries, [](const FLightLockCacheEntry& Entry) { return FLightLockStaticTable::GetMortonCode(Entry.Path); });
+
+    TArray<uint8> Packed;
+    Packed.Reserve(Entries.Num() * 24);
+    FIntVector Prev(0, 0, 0);
+    for (const FLightLockCacheEntry& Entry : Entries)
+    {
+        const FLightPath& Path = Entry.Path;
+        WriteSignedVarInt(Packed, static_cast<int64>(Path.PositionValidation.X) - Prev.X);
+        WriteSignedVarInt(Packed, static_cast<int64>(Path.PositionValidation.Y) - Prev.Y);
+        WriteSignedVarInt(Packed, static_cast<int64>(Path.PositionValidation.Z) - Prev.Z);
+        Prev = Path.PositionValidation;
+        WriteRaw(Packed, Entry.Hash);
+        WriteSignedVarInt(Packed, Path.NormalValidation.X);
+        WriteSignedVarInt(Packed, Path.NormalValidation.Y);
+        WriteSignedVarInt(Packed, Path.NormalValidation.Z);
+        WriteRaw(Packed, FFloat16(Path.Color.R));
+        WriteRaw(Packed, FFloat16(Path.Color.G));
+        WriteRaw(Packed, FFloat16(Path.Color.B));
+        WriteRaw(Packed, FFloat16(Path.Color.A));
+        WriteRaw(Packed, FFloat16(Path.Weight));
+        WriteRaw(Packed, QuantizeConfidence(Path.Confidence));
+        WriteRaw(Packed, Path.BounceCount);
+        WriteRaw(Packed, Path.Flags);
+        WriteRaw(Packed, static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Path.Roughness * 255.0f), 0, 255)));
+    }
+
+    uint8 Flags = 0;
+    TArray<uint8> Compressed;
+    int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Packed.Num());
+    Compressed.SetNumUninitialized(CompressedSize);
+    if (Packed.Num() > 0 && FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Packed.GetData(), Packed.Num()) && CompressedSize < Packed.Num())
+    {
+        Compressed.SetNum(CompressedSize);
+        Flags |= DELTA_FLAG_COMPRESSED;
+    }
+    const TArray<uint8>& Payload = (Flags & DELTA_FLAG_COMPRESSED) ? Compressed : Packed;
+
+    OutBytes.Reset();
+    WriteRaw(OutBytes, LIGHTLOCK_DELTA_MAGIC);
+    WriteRaw(OutBytes, LIGHTLOCK_DELTA_VERSION);
+    WriteRaw(OutBytes, Flags);
+    WriteRaw(OutBytes, Header.Environment.TimeOfDayBucket);
+    WriteRaw(OutBytes, Header.Environment.LightSetHash);
+    WriteRaw(OutBytes, Header.WorldSpacePrecision);
+    WriteRaw(OutBytes, Header.Epoch);
+    WriteRaw(OutBytes, static_cast<uint32>(Entries.Num()));
+    WriteRaw(OutBytes, static_cast<uint32>(Packed.Num()));
+    WriteRaw(OutBytes, static_cast<uint32>(Payload.Num()));
+    OutBytes.Append(Payload);
+}
+
+bool FLightLockDeltaCodec::Decode(TConstArrayView<uint8> Bytes, FLightLockDeltaHeader& OutHeader, TArray<FLightLockCacheEntry>& OutEntries)
+{
+    OutEntries.Reset();
+    FReader Header(Bytes.GetData(), Bytes.Num());
+    uint32 Magic = 0, Version = 0, Count = 0, PackedSize = 0, PayloadSize = 0;
+    uint8 Flags = 0;
+    if (!Header.ReadRaw(Magic) || !Header.ReadRaw(Version) || Magic != LIGHTLOCK_DELTA_MAGIC || Version != LIGHTLOCK_DELTA_VERSION) return false;
+    if (!Header.ReadRaw(Flags) || !Header.ReadRaw(OutHeader.Environment.TimeOfDayBucket) || !Header.ReadRaw(OutHeader.Environment.LightSetHash)
+        || !Header.ReadRaw(OutHeader.WorldSpacePrecision) || !Header.ReadRaw(OutHeader.Epoch)
+        || !Header.ReadRaw(Count) || !Header.ReadRaw(PackedSize) || !Header.ReadRaw(PayloadSize))
+    {
+        return false;
+    }
+    constexpr int64 HeaderSize = 4 + 4 + 1 + 4 + 4 + 4 + 8 + 4 + 4 + 4;
+    // The header comes from a peer: do the bounds math in int64 and reject before allocating.
+    const int64 NumEntries = Count;
+    const int64 NumPacked = PackedSize;
+    const int64 NumPayload = PayloadSize;
+    if (HeaderSize + NumPayload != Bytes.Num()) return false;
+    if (NumPacked > DELTA_MAX_PACKED_BYTES || NumEntries * DELTA_MIN_ENTRY_BYTES > NumPacked || NumPacked > NumEntries * DELTA_MAX_ENTRY_BYTES) return false;
+    if ((Flags & DELTA_FLAG_COMPRESSED) && NumPacked > NumPayload * DELTA_MAX_COMPRESSION_RATIO) return false;
+
+    TArray<uint8> Unpacked;
+    const uint8* Packed = Bytes.GetData() + HeaderSize;
+    if (Flags & DELTA_FLAG_COMPRESSED)
+    {
+        Unpacked.SetNumUninitialized(static_cast<int32>(NumPacked));
+        if (!FCompression::UncompressMemory(NAME_Zlib, Unpacked.GetData(), static_cast<int32>(NumPacked), Packed, static_cast<int32>(NumPayload))) return false;
+        Packed = Unpacked.GetData();
+    }
+    else if (PayloadSize != PackedSize)
+    {
+        return false;
+    }
+
+    FReader Reader(Packed, PackedSize);
+    OutEntries.Reserve(static_cast<int32>(NumEntries));
+    int64 Prev[3] = {};
+    for (uint32 i = 0; i < Count; ++i)
+    {
+        int64 Position[3], Normal[3];
+        FFloat16 R, G, B, A, Weight;
+        uint8 Confidence, BounceCount, PathFlags, Roughness;
+        FLightLockCacheEntry& Entry = OutEntries.AddDefaulted_GetRef();
+        bool bOk = Reader.ReadSignedVarInt(Position[0]) && Reader.ReadSignedVarInt(Position[1]) && Reader.ReadSignedVarInt(Position[2])
+            && Reader.ReadRaw(Entry.Hash)
+            && Reader.ReadSignedVarInt(Normal[0]) && Reader.ReadSignedVarInt(Normal[1]) && Reader.ReadSignedVarInt(Normal[2])
+            && Reader.ReadRaw(R) && Reader.ReadRaw(G) && Reader.ReadRaw(B) && Reader.ReadRaw(A) && Reader.ReadRaw(Weight)
+            && Reader.ReadRaw(Confidence) && Reader.ReadRaw(BounceCount) && Reader.ReadRaw(PathFlags) && Reader.ReadRaw(Roughness);
+        if (!bOk)
+        {
+            OutEntries.Reset();
+            return false;
+        }
+        for (int32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Prev[Axis] += Position[Axis];
+        }
+        FLightPath& Path = Entry.Path;
+        Path.Color = FLinearColor(R.GetFloat(), G.GetFloat(), B.GetFloat(), A.GetFloat());
+        Path.Weight = Weight.GetFloat();
+        Path.Confidence = Confidence / 255.0f;
+        Path.BounceCount = BounceCount;
+        Path.Flags = PathFlags;
+        Path.Roughness = Roughness / 255.0f;
+        Path.PositionValidation = FIntVector(static_cast<int32>(Prev[0]), static_cast<int32>(Prev[1]), static_cast<int32>(Prev[2]));
+        Path.NormalValidation = FIntVector(static_cast<int32>(Normal[0]), static_cast<int32>(Normal[1]), static_cast<int32>(Normal[2]));
+        Path.IncidentDirection = -FVector(Path.NormalValidation) / 1000.0f;
+    }
+    return Reader.IsAtEnd();
+}
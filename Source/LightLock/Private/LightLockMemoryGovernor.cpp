@@ -0,0 +1,82 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockMemoryGovernor.h"
+
+static uint64 CounterDelta(uint64 Current, uint64 Previous)
+{
+    return Current >= Previous ? Current - Previous : Current;
+}
+
+FLightLockMemoryGovernor::FLightLockMemoryGovernor(SIZE_T InBudgetBytes, float InStaticFraction, bool bInAdaptive, SIZE_T InStaticEntryBytes, SIZE_T InDynamicEntryBytes)
+    : BudgetBytes(InBudgetBytes)
+    , StaticFraction(FMath::Clamp(InStaticFraction, MIN_FRACTION, MAX_FRACTION))
+    , bAdaptive(bInAdaptive)
+    , StaticEntryBytes(FMath::Max<SIZE_T>(InStaticEntryBytes, 1))
+    , DynamicEntryBytes(FMath::Max<SIZE_T>(InDynamicEntryBytes, 1))
+{
+    Recompute(0);
+}
+
+void FLightLockMemoryGovernor::Update(const FSample& Sample)
+{
+    if (bTrimRequested.exchange(false))
+    {
+        PressureScale = FMath::Max(0.25f, PressureScale * 0.5f);
+        UE_LOG(LogTemp, Log, TEXT("LightLock: Memory trim, budget scaled to %.0f%%"), PressureScale * 100.0f);
+    }
+    else
+    {
+        PressureScale = FMath::Min(1.0f, PressureScale + 0.05f);
+    }
+
+    if (Sample.StaticEntries > 0)
+    {
+        StaticEntryBytes = FMath::Lerp(StaticEntryBytes, static_cast<double>(Sample.StaticBytes) / Sample.StaticEntries, 0.5);
+    }
+    if (Sample.DynamicEntries > 0)
+    {
+        DynamicEntryBytes = FMath::Lerp(DynamicEntryBytes, static_cast<double>(Sample.DynamicBytes) / Sample.DynamicEntries, 0.5);
+    }
+
+    if (bAdaptive && bHasPrevious)
+    {
+        uint64 StaticHits = CounterDelta(Sample.StaticHits, Previous.StaticHits);
+        uint64 DynamicHits = CounterDelta(Sample.DynamicHits, Previous.DynamicHits);
+        uint64 StaticEvictions = CounterDelta(Sample.StaticEvictions, Previous.StaticEvictions);
+        uint64 DynamicEvictions = CounterDelta(Sample.DynamicEvictions, Previous.DynamicEvictions);
+
+        // A layer that keeps evicting while still serving hits is worth more memory than one that is not.
+        double StaticValue = static_cast<double>(StaticEvictions) / StaticCapacity * (1.0 + StaticHits);
+        double DynamicValue = static_cast<double>(DynamicEvictions) / DynamicCapacity * (1.0 + DynamicHits);
+        if (StaticValue > DynamicValue * 1.25)
+        {
+            StaticFraction += FRACTION_STEP;
+        }
+        else if (DynamicValue > StaticValue * 1.25)
+        {
+            StaticFraction -= FRACTION_STEP;
+        }
+        else if (StaticEvictions == 0 && DynamicEvictions == 0)
+        {
+            if (Sample.StaticEntries < StaticCapacity / 2 && Sample.DynamicEntries >= DynamicCapacity * 9 / 10)
+            {
+                StaticFraction -= FRACTION_STEP;
+            }
+            else if (Sample.DynamicEntries < DynamicCapacity / 2 && Sample.StaticEntries >= StaticCapacity * 9 / 10)
+            {
+                StaticFraction += FRACTION_STEP;
+            }
+        }
+        StaticFraction = FMath::Clamp(StaticFraction, MIN_FRACTION, MAX_FRACTION);
+    }
+    Previous = Sample;
+    bHasPrevious = true;
+    Recompute(Sample.OverheadBytes);
+}
+
+void FLightLockMemoryGovernor::Recompute(SIZE_T OverheadBytes)
+{
+    double Available = FMath::Max(0.0, static_cast<double>(GetBudgetBytes()) - static_cast<double>(OverheadBytes));
+    StaticCapacity = static_cast<int32>(FMath::Clamp(Available * StaticFraction / StaticEntryBytes, static_cast<double>(MIN_CAPACITY), static_cast<double>(MAX_int32)));
+    DynamicCapacity = static_cast<int32>(FMath::Clamp(Available * (1.0f - StaticFraction) / DynamicEntryBytes, static_cast<double>(MIN_CAPACITY), static_cast<double>(MAX_int32)));
+}
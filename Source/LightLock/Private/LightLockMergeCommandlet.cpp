@@ -0,0 +1,343 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockMergeCommandlet.h"
+#include "LightLockCore.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Algo/Sort.h"
+
+namespace LightLockMerge
+{
+    static constexpr int32 CONFIDENCE_BUCKETS = 1024;
+
+    // Run files are private to one merge, so records are spilled as raw bytes.
+    struct FRecord
+    {
+        uint64 SortKey = 0;
+        int64 Timestamp = 0;
+        FLightLockCacheEntry Entry;
+    };
+
+    // Buffers records up to a memory budget, spills each full buffer as a sorted run, then streams all runs
+    // back in SortKey order with a k-way merge. Only one record per run is resident while merging.
+    class FExternalSorter
+    {
+    public:
+        FExternalSorter(const FString& InTempDir, int64 MemoryBytes)
+            : TempDir(InTempDir)
+            , BufferCapacity(FMath::Max<int64>(MemoryBytes / sizeof(FRecord), 1024))
+        {
+        }
+
+        ~FExternalSorter()
+        {
+            Cursors.Empty();
+            for (const FString& Path : RunPaths)
+            {
+                IFileManager::Get().Delete(*Path, false, true, true);
+            }
+        }
+
+        bool Add(const FRecord& Record)
+        {
+            Buffer.Add(Record);
+            return Buffer.Num() < BufferCapacity || SpillRun();
+        }
+
+        bool Finish()
+        {
+            if (Buffer.Num() > 0 && !SpillRun()) return false;
+            Buffer.Empty();
+
+            Cursors.SetNum(RunPaths.Num());
+            for (int32 i = 0; i < RunPaths.Num(); ++i)
+            {
+                Cursors[i].Reader.Reset(IFileManager::Get().CreateFileReader(*RunPaths[i]));
+                if (!Cursors[i].Reader) return false;
+                if (Advance(i)) Heap.HeapPush(i, FCursorLess(Cursors));
+            }
+            return true;
+        }
+
+        bool Next(FRecord& OutRecord)
+        {
+            if (Heap.Num() == 0) return false;
+            int32 Run;
+            Heap.HeapPop(Run, FCursorLess(Cursors));
+            OutRecord = Cursors[Run].Current;
+            if (Advance(Run)) Heap.HeapPush(Run, FCursorLess(Cursors));
+            return true;
+        }
+
+        int32 GetNumRuns() const { return RunPaths.Num(); }
+
+    private:
+        struct FRunCursor
+        {
+            TUniquePtr<FArchive> Reader;
+            FRecord Current;
+        };
+
+        struct FCursorLess
+        {
+            const TArray<FRunCursor>& Cursors;
+            explicit FCursorLess(const TArray<FRunCursor>& InCursors) : Cursors(InCursors) {}
+            bool operator()(int32 A, int32 B) const { return Cursors[A].Current.SortKey < Cursors[B].Current.SortKey; }
+        };
+
+        bool SpillRun()
+        {
+            Algo::SortBy(Buffer, &FRecord::SortKey);
+            FString Path = TempDir / FString::Printf(TEXT("run_%s.tmp"), *FGuid::NewGuid().ToString());
+            TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path));
+            if (!Writer) return false;
+            RunPaths.Add(Path);
+            Writer->Serialize(Buffer.GetData(), Buffer.Num() * sizeof(FRecord));
+            Buffer.Reset();
+            return Writer->Close();
+        }
+
+        bool Advance(int32 Run)
+        {
+            FArchive& Reader = *Cursors[Run].Reader;
+            if (Reader.AtEnd()) return false;
+            Reader.Serialize(&Cursors[Run].Current, sizeof(FRecord));
+            return !Reader.IsError();
+        }
+
+        FString TempDir;
+        int64 BufferCapacity;
+        TArray<FRecord> Buffer;
+        TArray<FString> RunPaths;
+        TArray<FRunCursor> Cursors;
+        TArray<int32> Heap;
+    };
+
+    // Two copies describe the same surface if they pass each other's FLightPath validation tolerances.
+    static bool ValidationAgrees(const FLightPath& A, const FLightPath& B)
+    {
+        FIntVector P = A.PositionValidation - B.PositionValidation;
+        FIntVector N = A.NormalValidation - B.NormalValidation;
+        return FMath::Abs(P.X) <= 1 && FMath::Abs(P.Y) <= 1 && FMath::Abs(P.Z) <= 1
+            && FMath::Abs(N.X) <= 10 && FMath::Abs(N.Y) <= 10 && FMath::Abs(N.Z) <= 10;
+    }
+
+    static int32 GetConfidenceBucket(float Confidence)
+    {
+        return FMath::Clamp(FMath::FloorToInt(Confidence * CONFIDENCE_BUCKETS), 0, CONFIDENCE_BUCKETS - 1);
+    }
+
+    static TArray<FString> GatherInputs(const FString& Params)
+    {
+        TArray<FString> Inputs;
+        FString InputList;
+        if (FParse::Value(*Params, TEXT("Inputs="), InputList, false))
+        {
+            InputList.ParseIntoArray(Inputs, TEXT(","));
+        }
+        FString InputDir;
+        if (FParse::Value(*Params, TEXT("InputDir="), InputDir))
+        {
+            TArray<FString> Found;
+            IFileManager::Get().FindFiles(Found, *(InputDir / TEXT("*.bin")), true, false);
+            Found.Sort();
+            for (const FString& File : Found)
+            {
+                Inputs.Add(InputDir / File);
+            }
+        }
+        return Inputs;
+    }
+}
+
+using namespace LightLockMerge;
+
+ULightLockMergeCommandlet::ULightLockMergeCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 ULightLockMergeCommandlet::Main(const FString& Params)
+{
+    TArray<FString> Inputs = GatherInputs(Params);
+    if (Inputs.Num() == 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Merge: Missing -Inputs=<a.bin,b.bin> or -InputDir=<dir>"));
+        return 1;
+    }
+    FString Output = TEXT("LightLock/cache.bin");
+    FParse::Value(*Params, TEXT("Output="), Output);
+    FString OutputPath = FPaths::IsRelative(Output) ? FPaths::ProjectSavedDir() / Output : Output;
+    int64 MaxEntries = 0;
+    FParse::Value(*Params, TEXT("MaxEntries="), MaxEntries);
+    int64 MaxMB = 0;
+    if (FParse::Value(*Params, TEXT("MaxMB="), MaxMB) && MaxMB > 0)
+    {
+        // Worst case is one tile per entry; the merge writes no hot set, so the trailer is otherwise fixed.
+        int64 Budget = MaxMB * 1024 * 1024 - FLightLockCacheFileWriter::HEADER_BYTES - FLightLockCacheFileWriter::TRAILER_BYTES;
+        MaxEntries = FMath::Max<int64>(Budget / (FLightLockCacheFileWriter::ENTRY_BYTES + FLightLockCacheFileWriter::TILE_BYTES), 1);
+    }
+    int64 MemoryMB = 256;
+    FParse::Value(*Params, TEXT("MemoryMB="), MemoryMB);
+    // Both sorters hold a full buffer at most once each, and never at the same time.
+    int64 MemoryBytes = FMath::Max<int64>(MemoryMB, 1) * 1024 * 1024;
+
+    FString TempDir = FPaths::ProjectSavedDir() / TEXT("LightLock/MergeTemp");
+    IFileManager::Get().MakeDirectory(*TempDir, true);
+    double StartTime = FPlatformTime::Seconds();
+
+    // Pass 1: stream every input into runs sorted by hash.
+    FExternalSorter ByHash(TempDir, MemoryBytes);
+    FLightLockEnvironmentKey Environment;
+    bool bHaveEnvironment = false;
+    int64 NumRead = 0;
+    for (const FString& Input : Inputs)
+    {
+        FLightLockCacheFileReader Reader;
+        if (!Reader.Open(Input))
+        {
+            UE_LOG(LogTemp, Warning, TEXT("LightLock Merge: Skipping unreadable %s"), *Input);
+            continue;
+        }
+        if (!bHaveEnvironment)
+        {
+            Environment = Reader.GetEnvironment();
+            bHaveEnvironment = true;
+        }
+        else if (Reader.GetEnvironment() != Environment)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("LightLock Merge: Skipping %s, captured for a different lighting environment"), *Input);
+            continue;
+        }
+
+        FRecord Record;
+        Record.Timestamp = IFileManager::Get().GetTimeStamp(*Input).GetTicks();
+        uint32 FileEntries = 0;
+        while (Reader.Next(Record.Entry))
+        {
+            Record.SortKey = Record.Entry.Hash;
+            if (!ByHash.Add(Record))
+            {
+                UE_LOG(LogTemp, Error, TEXT("LightLock Merge: Failed to write a sort run to %s"), *TempDir);
+                return 1;
+            }
+            FileEntries++;
+        }
+        if (FileEntries != Reader.GetCount())
+        {
+            UE_LOG(LogTemp, Warning, TEXT("LightLock Merge: %s is truncated, kept %u of %u entries"), *Input, FileEntries, Reader.GetCount());
+        }
+        NumRead += FileEntries;
+    }
+    if (!bHaveEnvironment || !ByHash.Finish())
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Merge: No readable inputs"));
+        return 1;
+    }
+
+    // Pass 2: resolve each hash group, histogram the winners' confidence and re-sort them spatially.
+    FExternalSorter BySpace(TempDir, MemoryBytes);
+    TArray<int64> Histogram;
+    Histogram.SetNumZeroed(CONFIDENCE_BUCKETS);
+    int64 NumUnique = 0;
+    int64 NumDuplicates = 0;
+    int64 NumConflicts = 0;
+    TArray<FRecord> Group;
+    FRecord Record;
+    bool bHaveRecord = ByHash.Next(Record);
+    while (bHaveRecord)
+    {
+        Group.Reset();
+        Group.Add(Record);
+        while ((bHaveRecord = ByHash.Next(Record)) && Record.Entry.Hash == Group[0].Entry.Hash)
+        {
+            Group.Add(Record);
+        }
+
+        const FRecord* Best = &Group[0];
+        bool bConflict = false;
+        for (const FRecord& Candidate : Group)
+        {
+            if (!ValidationAgrees(Candidate.Entry.Path, Group[0].Entry.Path))
+            {
+                bConflict = true;
+                break;
+            }
+            float Confidence = Candidate.Entry.Path.Confidence;
+            float BestConfidence = Best->Entry.Path.Confidence;
+            if (Confidence > BestConfidence || (Confidence == BestConfidence && Candidate.Timestamp > Best->Timestamp))
+            {
+                Best = &Candidate;
+            }
+        }
+        if (bConflict)
+        {
+            NumConflicts += Group.Num();
+            continue;
+        }
+
+        NumUnique++;
+        NumDuplicates += Group.Num() - 1;
+        Histogram[GetConfidenceBucket(Best->Entry.Path.Confidence)]++;
+        FRecord Winner = *Best;
+        Winner.SortKey = FLightLockStaticTable::GetMortonCode(Winner.Entry.Path);
+        if (!BySpace.Add(Winner))
+        {
+            UE_LOG(LogTemp, Error, TEXT("LightLock Merge: Failed to write a sort run to %s"), *TempDir);
+            return 1;
+        }
+    }
+    int32 HashRuns = ByHash.GetNumRuns();
+    if (!BySpace.Finish())
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Merge: Failed to read back sort runs"));
+        return 1;
+    }
+
+    // Keep the highest-confidence buckets that fit; the boundary bucket is filled first-come in spatial order.
+    int32 ThresholdBucket = 0;
+    int64 BoundaryQuota = MAX_int64;
+    if (MaxEntries > 0 && NumUnique > MaxEntries)
+    {
+        int64 Kept = 0;
+        for (ThresholdBucket = CONFIDENCE_BUCKETS - 1; ThresholdBucket > 0; --ThresholdBucket)
+        {
+            if (Kept + Histogram[ThresholdBucket] >= MaxEntries) break;
+            Kept += Histogram[ThresholdBucket];
+        }
+        BoundaryQuota = MaxEntries - Kept;
+    }
+
+    // Pass 3: write the survivors in Morton order.
+    FLightLockCacheFileWriter Writer;
+    if (!Writer.Open(OutputPath, Environment))
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Merge: Failed to open %s"), *OutputPath);
+        return 1;
+    }
+    int64 BoundaryKept = 0;
+    while (BySpace.Next(Record))
+    {
+        int32 Bucket = GetConfidenceBucket(Record.Entry.Path.Confidence);
+        if (Bucket < ThresholdBucket) continue;
+        if (Bucket == ThresholdBucket && BoundaryKept++ >= BoundaryQuota) continue;
+        Writer.Write(Record.Entry);
+    }
+    uint32 NumWritten = Writer.GetCount();
+    if (!Writer.Close())
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Merge: Failed to write %s"), *OutputPath);
+        return 1;
+    }
+
+    UE_LOG(LogTemp, Display, TEXT("LightLock Merge: %d files, %lld entries read, %lld duplicates resolved, %lld dropped as collisions, %lld trimmed"),
+        Inputs.Num(), NumRead, NumDuplicates, NumConflicts, NumUnique - NumWritten);
+    UE_LOG(LogTemp, Display, TEXT("LightLock Merge: Wrote %u entries to %s (%d sort runs, %.1fs)"),
+        NumWritten, *OutputPath, HashRuns + BySpace.GetNumRuns(), FPlatformTime::Seconds() - StartTime);
+    return 0;
+}
@@ -0,0 +1,22 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LightLockMergeCommandlet.generated.h"
+
+// Merges static cache files from many machines into one Morton-ordered file in bounded memory.
+// UnrealEditor-Cmd <Project> -run=LightLockMerge -Inputs=a.bin,b.bin | -InputDir=<dir> [-Output=LightLock/cache.bin]
+//     [-MaxEntries=N | -MaxMB=N] [-MemoryMB=256]
+// Duplicate hashes keep the entry with the highest confidence, then the newest file. Hashes whose copies disagree
+// on position or normal validation are collisions and are dropped. -MaxEntries/-MaxMB trims the lowest-confidence entries.
+UCLASS()
+class ULightLockMergeCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    ULightLockMergeCommandlet();
+    virtual int32 Main(const FString& Params) override;
+};
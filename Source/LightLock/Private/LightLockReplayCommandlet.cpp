@@ -0,0 +1,194 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockReplayCommandlet.h"
+#include "LightLockCore.h"
+#include "LightLockReport.h"
+#include "LightLockTrace.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/UnrealType.h"
+
+using LightLockReport::FLatencySamples;
+
+static void ApplyConfigOverrides(const FString& Params, FLightLockConfig& Config)
+{
+    for (TFieldIterator<FProperty> It(FLightLockConfig::StaticStruct()); It; ++It)
+    {
+        FString Value;
+        if (FParse::Value(*Params, *(It->GetName() + TEXT("=")), Value))
+        {
+            It->ImportText_Direct(*Value, It->ContainerPtrToValuePtr<void>(&Config), nullptr, PPF_None);
+            UE_LOG(LogTemp, Display, TEXT("LightLock Replay: %s=%s"), *It->GetName(), *Value);
+        }
+    }
+}
+
+static const TCHAR* GetTraceOpName(ELightLockTraceOp Op)
+{
+    switch (Op)
+    {
+    case ELightLockTraceOp::Query: return TEXT("query");
+    case ELightLockTraceOp::Store: return TEXT("store");
+    case ELightLockTraceOp::InvalidateRegion: return TEXT("invalidate");
+    case ELightLockTraceOp::UpdateCamera: return TEXT("update_camera");
+    case ELightLockTraceOp::AdvanceFrame: return TEXT("advance_frame");
+    case ELightLockTraceOp::CullDistantEntries: return TEXT("cull");
+    case ELightLockTraceOp::ClearDynamic: return TEXT("clear_dynamic");
+    case ELightLockTraceOp::ClearAll: return TEXT("clear_all");
+    default: return TEXT("unknown");
+    }
+}
+
+ULightLockReplayCommandlet::ULightLockReplayCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 ULightLockReplayCommandlet::Main(const FString& Params)
+{
+    FString TracePath;
+    if (!FParse::Value(*Params, TEXT("Trace="), TracePath))
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Replay: Missing -Trace=<file>"));
+        return 1;
+    }
+    FString OutputPath = FPaths::ProjectSavedDir() / TEXT("LightLock/Replay.json");
+    FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+    FLightLockTraceReader Reader;
+    TArray<FLightLockTraceEvent> Events;
+    if (!Reader.LoadFromFile(TracePath) || !Reader.ReadAll(Events))
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Replay: Failed to read trace %s"), *TracePath);
+        return 1;
+    }
+
+    FLightLockConfig Config;
+    Config.WorldSpacePrecision = Reader.GetWorldSpacePrecision();
+    ApplyConfigOverrides(Params, Config);
+    Config.CachePath = TEXT("LightLock/Replay/cache.bin");
+    Config.bEnableAsyncLoading = false;
+    bool bRehash = FParse::Param(*Params, TEXT("Rehash")) || !FMath::IsNearlyEqual(Config.WorldSpacePrecision, Reader.GetWorldSpacePrecision());
+    FString CacheFile = FPaths::ProjectSavedDir() / Config.CachePath;
+    IFileManager::Get().Delete(*CacheFile, false, true, true);
+
+    FLatencySamples Latency[static_cast<int32>(ELightLockTraceOp::Num)];
+    int64 RecordedQueries = 0;
+    int64 RecordedHits = 0;
+    int64 ReplayHits = 0;
+    int64 Frames = 0;
+    FLightLockStats FinalStats;
+    SIZE_T FinalMemory = 0;
+    double Seconds = 0.0;
+    {
+        FLightLockCore Core(Config);
+        double StartTime = FPlatformTime::Seconds();
+        for (const FLightLockTraceEvent& Event : Events)
+        {
+            uint32 Hash = bRehash ? FLightLockHasher::HashWorldSpace(Event.Position, Event.Normal, Config.WorldSpacePrecision) : Event.Hash;
+            uint64 StartCycles = FPlatformTime::Cycles64();
+            switch (Event.Op)
+            {
+            case ELightLockTraceOp::Query:
+            {
+                FLinearColor Color;
+                float Weight;
+                if (Core.Query(Hash, Event.Position, Event.Normal, Color, Weight)) ReplayHits++;
+                RecordedQueries++;
+                if (Event.bHit) RecordedHits++;
+                break;
+            }
+            case ELightLockTraceOp::Store:
+                Core.Store(Hash, Event.Color, Event.Weight, Event.Position, Event.Normal, Event.bIsStatic, Event.BounceCount, Event.Confidence);
+                break;
+            case ELightLockTraceOp::InvalidateRegion:
+                Core.InvalidateRegion(Event.Region);
+                break;
+            case ELightLockTraceOp::UpdateCamera:
+                Core.UpdateCamera(Event.Position, Event.Normal, Event.FOV, Event.FarPlane, Event.DeltaTime);
+                break;
+            case ELightLockTraceOp::AdvanceFrame:
+                Core.AdvanceFrame();
+                Frames++;
+                break;
+            case ELightLockTraceOp::CullDistantEntries:
+                Core.CullDistantEntries(Event.Position, Event.MaxDistance);
+                break;
+            case ELightLockTraceOp::ClearDynamic:
+                Core.ClearDynamic();
+                break;
+            case ELightLockTraceOp::ClearAll:
+                Core.ClearAll();
+                break;
+            default:
+                break;
+            }
+            Latency[static_cast<int32>(Event.Op)].Add(FPlatformTime::Cycles64() - StartCycles);
+        }
+        Seconds = FPlatformTime::Seconds() - StartTime;
+        FinalStats = Core.GetStats();
+        FinalMemory = Core.GetMemoryUsage();
+    }
+    IFileManager::Get().Delete(*CacheFile, false, true, true);
+
+    TSharedRef<FJsonObject> ConfigJson = MakeShared<FJsonObject>();
+    for (TFieldIterator<FProperty> It(FLightLockConfig::StaticStruct()); It; ++It)
+    {
+        FString Value;
+        It->ExportTextItem_Direct(Value, It->ContainerPtrToValuePtr<void>(&Config), nullptr, nullptr, PPF_None);
+        ConfigJson->SetStringField(It->GetName(), Value);
+    }
+
+    TSharedRef<FJsonObject> LatencyJson = MakeShared<FJsonObject>();
+    for (int32 Op = 0; Op < static_cast<int32>(ELightLockTraceOp::Num); ++Op)
+    {
+        if (Latency[Op].Nanoseconds.Num() > 0)
+        {
+            LatencyJson->SetObjectField(GetTraceOpName(static_cast<ELightLockTraceOp>(Op)), Latency[Op].ToJson());
+        }
+    }
+
+    TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+    Report->SetStringField(TEXT("trace"), TracePath);
+    Report->SetNumberField(TEXT("format_version"), 1);
+    Report->SetObjectField(TEXT("config"), ConfigJson);
+    Report->SetBoolField(TEXT("rehashed"), bRehash);
+    Report->SetNumberField(TEXT("events"), Events.Num());
+    Report->SetNumberField(TEXT("frames"), static_cast<double>(Frames));
+    Report->SetNumberField(TEXT("seconds"), Seconds);
+    Report->SetNumberField(TEXT("recorded_hit_rate"), RecordedQueries > 0 ? static_cast<double>(RecordedHits) / RecordedQueries : 0.0);
+    Report->SetNumberField(TEXT("replay_hit_rate"), RecordedQueries > 0 ? static_cast<double>(ReplayHits) / RecordedQueries : 0.0);
+    Report->SetNumberField(TEXT("evictions"), static_cast<double>(FinalStats.Evictions));
+    Report->SetNumberField(TEXT("collisions"), static_cast<double>(FinalStats.Collisions));
+    Report->SetNumberField(TEXT("promotions"), static_cast<double>(FinalStats.Promotions));
+    Report->SetNumberField(TEXT("dropped_stores"), static_cast<double>(FinalStats.DroppedStores));
+    Report->SetNumberField(TEXT("admission_rejects"), static_cast<double>(FinalStats.AdmissionRejects));
+    Report->SetNumberField(TEXT("static_entries"), static_cast<double>(FinalStats.StaticCount));
+    Report->SetNumberField(TEXT("dynamic_entries"), static_cast<double>(FinalStats.DynamicCount));
+    Report->SetNumberField(TEXT("memory_bytes"), static_cast<double>(FinalMemory));
+    Report->SetObjectField(TEXT("latency"), LatencyJson);
+
+    FString Output;
+    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+    FJsonSerializer::Serialize(Report, Writer);
+    if (!FFileHelper::SaveStringToFile(Output, *OutputPath))
+    {
+        UE_LOG(LogTemp, Error, TEXT("LightLock Replay: Failed to write %s"), *OutputPath);
+        return 1;
+    }
+    UE_LOG(LogTemp, Display, TEXT("LightLock Replay: %d events, hit rate %.1f%% (recorded %.1f%%), %lld evictions. Wrote %s"),
+        Events.Num(),
+        RecordedQueries > 0 ? 100.0 * ReplayHits / RecordedQueries : 0.0,
+        RecordedQueries > 0 ? 100.0 * RecordedHits / RecordedQueries : 0.0,
+        FinalStats.Evictions,
+        *OutputPath);
+    return 0;
+}
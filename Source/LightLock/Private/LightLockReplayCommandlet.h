@@ -0,0 +1,20 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LightLockReplayCommandlet.generated.h"
+
+// Replays a recorded LightLock trace against any FLightLockConfig.
+// UnrealEditor-Cmd <Project> -run=LightLockReplay -nullrhi -Trace=<file> [-Rehash] [-Output=<path.json>]
+//     [-<FLightLockConfig property>=<value> ...], e.g. -StaticCapacity=65536 -WorldSpacePrecision=0.05
+UCLASS()
+class ULightLockReplayCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    ULightLockReplayCommandlet();
+    virtual int32 Main(const FString& Params) override;
+};
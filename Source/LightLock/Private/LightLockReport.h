@@ -0,0 +1,41 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformTime.h"
+
+// Helpers shared by the LightLock commandlets that emit machine-readable reports.
+namespace LightLockReport
+{
+    struct FLatencySamples
+    {
+        TArray<uint32> Nanoseconds;
+
+        void Add(uint64 Cycles)
+        {
+            static const double NanosecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1.0e9;
+            Nanoseconds.Add(static_cast<uint32>(FMath::Min<double>(Cycles * NanosecondsPerCycle, MAX_uint32)));
+        }
+
+        TSharedRef<FJsonObject> ToJson()
+        {
+            Nanoseconds.Sort();
+            auto Percentile = [this](double Fraction)
+            {
+                if (Nanoseconds.Num() == 0) return 0.0;
+                int32 Index = FMath::Min(Nanoseconds.Num() - 1, FMath::FloorToInt(Fraction * Nanoseconds.Num()));
+                return Nanoseconds[Index] / 1000.0;
+            };
+            TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+            Json->SetNumberField(TEXT("count"), Nanoseconds.Num());
+            Json->SetNumberField(TEXT("p50_us"), Percentile(0.50));
+            Json->SetNumberField(TEXT("p90_us"), Percentile(0.90));
+            Json->SetNumberField(TEXT("p99_us"), Percentile(0.99));
+            Json->SetNumberField(TEXT("p999_us"), Percentile(0.999));
+            Json->SetNumberField(TEXT("max_us"), Nanoseconds.Num() > 0 ? Nanoseconds.Last() / 1000.0 : 0.0);
+            return Json;
+        }
+    };
+}
@@ -0,0 +1,312 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockSharedCache.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Event.h"
+#include "Async/Async.h"
+#include "Misc/DateTime.h"
+
+static constexpr uint32 SHARED_ACCESS_READ_WRITE = static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Read) | static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Write);
+
+TUniquePtr<FLightLockSharedCache> FLightLockSharedCache::Open(const FString& Name, uint32 RecordCapacity, const FLightLockEnvironmentKey& Environment)
+{
+    TUniquePtr<FLightLockSharedCache> Cache(new FLightLockSharedCache(Name, RecordCapacity, Environment));
+    {
+        FWriteScopeLock Lock(Cache->RegionLock);
+        if (!Cache->Attach())
+        {
+            return nullptr;
+        }
+    }
+    Cache->HeartbeatEvent = FPlatformProcess::GetSynchEventFromPool(false);
+    Cache->HeartbeatThread = Async(EAsyncExecution::Thread, [Target = Cache.Get()]() { Target->RunHeartbeat(); });
+    return Cache;
+}
+
+FLightLockSharedCache::FLightLockSharedCache(const FString& InName, uint32 InRecordCapacity, const FLightLockEnvironmentKey& InEnvironment)
+    : Name(InName)
+    , RecordCapacity(FMath::Max<uint32>(InRecordCapacity, 1))
+    , Environment(InEnvironment)
+    , ProcessId(FPlatformProcess::GetCurrentProcessId())
+{
+    SlotCount = FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(RecordCapacity * 2, 64));
+    SlotShift = 32 - FMath::FloorLog2(SlotCount);
+    SlotsOffset = Align(sizeof(Header), PLATFORM_CACHE_LINE_SIZE);
+    RecordsOffset = Align(SlotsOffset + SlotCount * sizeof(Slot), PLATFORM_CACHE_LINE_SIZE);
+    MappedBytes = RecordsOffset + static_cast<SIZE_T>(RecordCapacity) * sizeof(FLightPath);
+}
+
+FLightLockSharedCache::~FLightLockSharedCache()
+{
+    bStopHeartbeat = true;
+    if (HeartbeatEvent)
+    {
+        HeartbeatEvent->Trigger();
+        HeartbeatThread.Wait();
+        FPlatformProcess::ReturnSynchEventToPool(HeartbeatEvent);
+    }
+    FWriteScopeLock Lock(RegionLock);
+    // A region Detach retains stays mapped until the process exits, which unmaps it without unlinking the name.
+    Detach();
+}
+
+void FLightLockSharedCache::BindRegion(FPlatformMemory::FSharedMemoryRegion* InRegion)
+{
+    Region = InRegion;
+    uint8* Base = static_cast<uint8*>(Region->GetAddress());
+    SegmentHeader = reinterpret_cast<Header*>(Base);
+    Slots = reinterpret_cast<Slot*>(Base + SlotsOffset);
+    Records = reinterpret_cast<FLightPath*>(Base + RecordsOffset);
+}
+
+bool FLightLockSharedCache::Attach()
+{
+    // Map writable so a stale or abandoned segment can be claimed.
+    // A region this process created and retained is still the one behind the name: nobody else unlinks it.
+    FPlatformMemory::FSharedMemoryRegion* Writable = RetainedRegion;
+    bool bCreated = Writable != nullptr;
+    RetainedRegion = nullptr;
+    if (!Writable)
+    {
+        Writable = FPlatformMemory::MapNamedSharedMemoryRegion(Name, false, SHARED_ACCESS_READ_WRITE, MappedBytes);
+    }
+    if (!Writable)
+    {
+        Writable = FPlatformMemory::MapNamedSharedMemoryRegion(Name, true, SHARED_ACCESS_READ_WRITE, MappedBytes);
+        bCreated = Writable != nullptr;
+    }
+    if (!Writable)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Could not map shared cache %s"), *Name);
+        return false;
+    }
+    BindRegion(Writable);
+    bCreatedRegion = bCreated;
+    
+    bool bInitialized = SegmentHeader->Magic.load(std::memory_order_acquire) == SHARED_MAGIC;
+    if (bInitialized && (SegmentHeader->LayoutVersion != SHARED_LAYOUT_VERSION
+        || SegmentHeader->RecordSize != sizeof(FLightPath)
+        || SegmentHeader->RecordCapacity != RecordCapacity
+        || SegmentHeader->SlotCount != SlotCount
+        || SegmentHeader->TimeOfDayBucket != Environment.TimeOfDayBucket
+        || SegmentHeader->LightSetHash != Environment.LightSetHash))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Shared cache %s has an incompatible layout, using a private cache"), *Name);
+        Detach();
+        return false;
+    }
+    SegmentHeader->AttachCount.fetch_add(1);
+    bCounted = true;
+    
+    uint32 Owner = SegmentHeader->OwnerPid.load();
+    if (!IsOwnerAlive() && TryClaimOwnership(Owner))
+    {
+        bIsOwner = true;
+        SegmentHeader->HeartbeatTicks.store(FDateTime::UtcNow().GetTicks());
+        if (!bInitialized)
+        {
+            InitializeHeader();
+        }
+        SegmentHeader->State.store(static_cast<uint32>(ESegmentState::Active));
+        UE_LOG(LogTemp, Log, TEXT("LightLock: Owning shared cache %s (%llu bytes)"), *Name, static_cast<uint64>(MappedBytes));
+        return true;
+    }
+    
+    // Readers keep the writable view: they still update AttachCount on Detach, and only the owner writes records.
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Attached to shared cache %s owned by process %u"), *Name, Owner);
+    return true;
+}
+
+void FLightLockSharedCache::Detach()
+{
+    if (!Region) return;
+    if (VerifyOwnership())
+    {
+        // Readers see the abandoned state on their next check and reattach, one of them taking ownership.
+        SegmentHeader->State.store(static_cast<uint32>(ESegmentState::Abandoned));
+        SegmentHeader->OwnerPid.store(0);
+    }
+    uint32 Remaining = 0;
+    if (bCounted)
+    {
+        Remaining = SegmentHeader->AttachCount.fetch_sub(1) - 1;
+        bCounted = false;
+    }
+    if (bCreatedRegion && Remaining > 0)
+    {
+        // Unmapping would unlink the name under the processes still attached, and the next one to reattach
+        // would create an empty segment beside theirs.
+        RetainedRegion = Region;
+    }
+    else
+    {
+        FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+    }
+    bCreatedRegion = false;
+    Region = nullptr;
+    SegmentHeader = nullptr;
+    Slots = nullptr;
+    Records = nullptr;
+    bIsOwner = false;
+}
+
+bool FLightLockSharedCache::TryClaimOwnership(uint32 ObservedOwner)
+{
+    return SegmentHeader->OwnerPid.compare_exchange_strong(ObservedOwner, ProcessId);
+}
+
+void FLightLockSharedCache::InitializeHeader()
+{
+    SegmentHeader->LayoutVersion = SHARED_LAYOUT_VERSION;
+    SegmentHeader->RecordSize = sizeof(FLightPath);
+    SegmentHeader->RecordCapacity = RecordCapacity;
+    SegmentHeader->SlotCount = SlotCount;
+    SegmentHeader->TimeOfDayBucket = Environment.TimeOfDayBucket;
+    SegmentHeader->LightSetHash = Environment.LightSetHash;
+    SegmentHeader->Generation.store(0);
+    SegmentHeader->NumRecords.store(0);
+    FMemory::Memzero(Slots, SlotCount * sizeof(Slot));
+    SegmentHeader->Magic.store(SHARED_MAGIC, std::memory_order_release);
+}
+
+bool FLightLockSharedCache::VerifyOwnership()
+{
+    if (!IsOwner()) return false;
+    if (SegmentHeader->OwnerPid.load() == ProcessId) return true;
+    // A reader decided this process was gone and claimed the segment; two writers must never share the seqlock.
+    if (bIsOwner.exchange(false))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: Lost ownership of shared cache %s to process %u"), *Name, SegmentHeader->OwnerPid.load());
+    }
+    return false;
+}
+
+void FLightLockSharedCache::RunHeartbeat()
+{
+    // Off the game thread, so the heartbeat keeps going through frame hitches.
+    while (!bStopHeartbeat.load())
+    {
+        {
+            FReadScopeLock Lock(RegionLock);
+            if (SegmentHeader && VerifyOwnership())
+            {
+                SegmentHeader->HeartbeatTicks.store(FDateTime::UtcNow().GetTicks(), std::memory_order_relaxed);
+            }
+        }
+        HeartbeatEvent->Wait(HEARTBEAT_INTERVAL_MS);
+    }
+}
+
+bool FLightLockSharedCache::IsOwnerAlive() const
+{
+    uint32 Owner = SegmentHeader->OwnerPid.load();
+    if (Owner == 0 || SegmentHeader->State.load() == static_cast<uint32>(ESegmentState::Abandoned)) return false;
+    if (Owner != ProcessId && !FPlatformProcess::IsApplicationRunning(Owner)) return false;
+    // A segment that is still being initialized has no heartbeat yet; its owner is alive by pid alone.
+    if (SegmentHeader->Magic.load(std::memory_order_acquire) != SHARED_MAGIC) return true;
+    return FDateTime::UtcNow().GetTicks() - SegmentHeader->HeartbeatTicks.load() < HEARTBEAT_TIMEOUT_TICKS;
+}
+
+bool FLightLockSharedCache::Find(uint32 Hash, FLightPath& OutPath) const
+{
+    FReadScopeLock Lock(RegionLock);
+    if (!SegmentHeader || SegmentHeader->Magic.load(std::memory_order_acquire) != SHARED_MAGIC) return false;
+    
+    uint32 Generation = SegmentHeader->Generation.load(std::memory_order_acquire);
+    if (Generation & 1) return false;
+    
+    bool bFound = false;
+    uint32 Mask = SlotCount - 1;
+    uint32 Index = (Hash * 2654435761u) >> SlotShift;
+    for (uint32 Probe = 0; Probe < SlotCount; ++Probe, Index = (Index + 1) & Mask)
+    {
+        Slot Current;
+        FMemory::Memcpy(&Current, &Slots[Index], sizeof(Slot));
+        if (Current.Record == 0) break;
+        if (Current.Hash == Hash)
+        {
+            if (Current.Record <= RecordCapacity)
+            {
+                FMemory::Memcpy(&OutPath, &Records[Current.Record - 1], sizeof(FLightPath));
+                bFound = true;
+            }
+            break;
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return bFound && SegmentHeader->Generation.load(std::memory_order_relaxed) == Generation;
+}
+
+void FLightLockSharedCache::BeginPublish()
+{
+    FReadScopeLock Lock(RegionLock);
+    if (!VerifyOwnership()) return;
+    // Force an odd generation even if a previous owner died mid-publish and left it odd.
+    PublishGeneration = SegmentHeader->Generation.load(std::memory_order_relaxed) | 1;
+    SegmentHeader->Generation.store(PublishGeneration, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    FMemory::Memzero(Slots, SlotCount * sizeof(Slot));
+    PublishCount = 0;
+}
+
+bool FLightLockSharedCache::Publish(uint32 Hash, const FLightPath& Path)
+{
+    FReadScopeLock Lock(RegionLock);
+    if (!IsOwner()) return false;
+    uint32 Mask = SlotCount - 1;
+    uint32 Index = (Hash * 2654435761u) >> SlotShift;
+    for (uint32 Probe = 0; Probe < SlotCount; ++Probe, Index = (Index + 1) & Mask)
+    {
+        Slot& Current = Slots[Index];
+        if (Current.Record == 0)
+        {
+            if (PublishCount >= RecordCapacity) return false;
+            FMemory::Memcpy(&Records[PublishCount], &Path, sizeof(FLightPath));
+            Current.Hash = Hash;
+            Current.Record = ++PublishCount;
+            return true;
+        }
+        if (Current.Hash == Hash)
+        {
+            FMemory::Memcpy(&Records[Current.Record - 1], &Path, sizeof(FLightPath));
+            return true;
+        }
+    }
+    return false;
+}
+
+void FLightLockSharedCache::EndPublish()
+{
+    FReadScopeLock Lock(RegionLock);
+    if (!VerifyOwnership()) return;
+    SegmentHeader->NumRecords.store(PublishCount, std::memory_order_relaxed);
+    SegmentHeader->Generation.store(PublishGeneration + 1, std::memory_order_release);
+}
+
+bool FLightLockSharedCache::Tick()
+{
+    if (IsOwner())
+    {
+        // The heartbeat thread keeps the claim fresh; here the owner only checks it still holds it.
+        FReadScopeLock Lock(RegionLock);
+        VerifyOwnership();
+        return false;
+    }
+    if (++TicksSinceCheck < OWNER_CHECK_INTERVAL) return false;
+    TicksSinceCheck = 0;
+    {
+        FReadScopeLock Lock(RegionLock);
+        if (SegmentHeader && IsOwnerAlive()) return false;
+    }
+    
+    FWriteScopeLock Lock(RegionLock);
+    Detach();
+    Attach();
+    return IsOwner();
+}
+
+int64 FLightLockSharedCache::GetNumRecords() const
+{
+    FReadScopeLock Lock(RegionLock);
+    return SegmentHeader ? SegmentHeader->NumRecords.load(std::memory_order_relaxed) : 0;
+}
@@ -1,16 +1,173 @@
 // Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
 
 #include "LightLockSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Engine/LevelBounds.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static ULightLockSubsystem* FindLightLockSubsystem(UWorld* World)
+{
+    UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+    return GameInstance ? GameInstance->GetSubsystem<ULightLockSubsystem>() : nullptr;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockTraceStartCommand(
+    TEXT("LightLock.Trace.Start"),
+    TEXT("Start recording LightLock calls into a ring buffer. Optional argument: buffer size in MB (default 64)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            Subsystem->StartTrace(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockTraceStopCommand(
+    TEXT("LightLock.Trace.Stop"),
+    TEXT("Stop recording LightLock calls and write the trace to Saved/LightLock/Traces. Optional argument: file name."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            Subsystem->StopTrace(Args.Num() > 0 ? Args[0] : FString(TEXT("LightLock.trace")));
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockDeltaExportCommand(
+    TEXT("LightLock.Delta.Export"),
+    TEXT("Write static entries stored since an epoch to Saved/LightLock/Deltas. Arguments: file name, optional epoch (default 0, everything)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            FString FileName = Args.Num() > 0 ? Args[0] : FString(TEXT("LightLock.delta"));
+            int64 Epoch = Subsystem->SaveLightingDelta(FileName, Args.Num() > 1 ? FCString::Atoi64(*Args[1]) : 0);
+            UE_LOG(LogTemp, Display, TEXT("LightLock.Delta.Export: next epoch %lld"), Epoch);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockDeltaImportCommand(
+    TEXT("LightLock.Delta.Import"),
+    TEXT("Merge a delta from Saved/LightLock/Deltas into the static cache. Argument: file name."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            Subsystem->LoadLightingDelta(Args.Num() > 0 ? Args[0] : FString(TEXT("LightLock.delta")));
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockStaticCapacityCommand(
+    TEXT("LightLock.StaticCapacity"),
+    TEXT("Print or set the static entry capacity. Shrinking evicts over the following frames."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            const FLightLockConfig& Config = Subsystem->GetConfiguration();
+            if (Args.Num() > 0) Subsystem->SetCacheCapacities(FCString::Atoi(*Args[0]), Config.DynamicCapacity);
+            UE_LOG(LogTemp, Display, TEXT("LightLock.StaticCapacity = %d"), Config.StaticCapacity);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockDynamicCapacityCommand(
+    TEXT("LightLock.DynamicCapacity"),
+    TEXT("Print or set the dynamic entry capacity. Shrinking evicts over the following frames."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            const FLightLockConfig& Config = Subsystem->GetConfiguration();
+            if (Args.Num() > 0) Subsystem->SetCacheCapacities(Config.StaticCapacity, FCString::Atoi(*Args[0]));
+            UE_LOG(LogTemp, Display, TEXT("LightLock.DynamicCapacity = %d"), Config.DynamicCapacity);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs GLightLockPrecisionCommand(
+    TEXT("LightLock.WorldSpacePrecision"),
+    TEXT("Print or set the world-space hashing cell size. Dynamic entries are re-keyed over the following frames; static entries are cleared."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        if (ULightLockSubsystem* Subsystem = FindLightLockSubsystem(World))
+        {
+            if (Args.Num() > 0) Subsystem->SetWorldSpacePrecision(FCString::Atof(*Args[0]));
+            UE_LOG(LogTemp, Display, TEXT("LightLock.WorldSpacePrecision = %g"), Subsystem->GetConfiguration().WorldSpacePrecision);
+        }
+    }));
+
+static void AccumulateLatency(FLightLockLatency& Total, const FLightLockLatency& Partition)
+{
+    Total.Count += Partition.Count;
+    Total.P50Microseconds = FMath::Max(Total.P50Microseconds, Partition.P50Microseconds);
+    Total.P99Microseconds = FMath::Max(Total.P99Microseconds, Partition.P99Microseconds);
+    Total.MaxMicroseconds = FMath::Max(Total.MaxMicroseconds, Partition.MaxMicroseconds);
+}
+
+static void AccumulateStats(FLightLockStats& Total, const FLightLockStats& Partition)
+{
+    double Hits = Total.HitRate * Total.TotalQueries + Partition.HitRate * Partition.TotalQueries;
+    Total.StaticCount += Partition.StaticCount;
+    Total.DynamicCount += Partition.DynamicCount;
+    Total.TotalQueries += Partition.TotalQueries;
+    Total.Misses += Partition.Misses;
+    Total.Collisions += Partition.Collisions;
+    Total.Promotions += Partition.Promotions;
+    Total.SpatialInvalidations += Partition.SpatialInvalidations;
+    Total.Evictions += Partition.Evictions;
+    Total.MemoryUsageBytes += Partition.MemoryUsageBytes;
+    Total.MemoryBudgetBytes += Partition.MemoryBudgetBytes;
+    Total.StaticCapacity += Partition.StaticCapacity;
+    Total.DynamicCapacity += Partition.DynamicCapacity;
+    Total.QueuedStores += Partition.QueuedStores;
+    Total.DroppedStores += Partition.DroppedStores;
+    Total.PendingStores += Partition.PendingStores;
+    Total.SharedCount += Partition.SharedCount;
+    Total.SharedHits += Partition.SharedHits;
+    Total.AdmissionRejects += Partition.AdmissionRejects;
+    Total.bSharedCacheOwner |= Partition.bSharedCacheOwner;
+    Total.HitRate = Total.TotalQueries > 0 ? static_cast<float>(Hits / Total.TotalQueries) : 0.0f;
+    AccumulateLatency(Total.QueryLatency, Partition.QueryLatency);
+    AccumulateLatency(Total.StoreLatency, Partition.StoreLatency);
+    AccumulateLatency(Total.EvictionLatency, Partition.EvictionLatency);
+    AccumulateLatency(Total.InvalidateLatency, Partition.InvalidateLatency);
+    AccumulateLatency(Total.CullLatency, Partition.CullLatency);
+    AccumulateLatency(Total.SaveLatency, Partition.SaveLatency);
+    AccumulateLatency(Total.QueryBatchLatency, Partition.QueryBatchLatency);
+    AccumulateLatency(Total.StaticLockWait, Partition.StaticLockWait);
+    AccumulateLatency(Total.DynamicLockWait, Partition.DynamicLockWait);
+}
 
 void ULightLockSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
     Super::Initialize(Collection);
     Core = MakeUnique<FLightLockCore>(Configuration);
+    ActiveEnvironment = Configuration.Environment;
+    if (Configuration.bEnableLevelPartitions)
+    {
+        LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &ULightLockSubsystem::OnLevelAddedToWorld);
+        LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &ULightLockSubsystem::OnLevelRemovedFromWorld);
+    }
+    EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &ULightLockSubsystem::OnEndFrame);
     UE_LOG(LogTemp, Log, TEXT("LightLock Subsystem initialized"));
 }
 
 void ULightLockSubsystem::Deinitialize()
 {
+    FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+    FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+    FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+    TMap<FName, FLevelPartition> Released;
+    {
+        FWriteScopeLock Lock(PartitionLock);
+        Released = MoveTemp(Partitions);
+        Partitions.Reset();
+    }
+    Released.Empty();
     if (Core.IsValid())
     {
         Core->Flush();
@@ -19,62 +176,364 @@ void ULightLockSubsystem::Deinitialize()
     Super::Deinitialize();
 }
 
+void ULightLockSubsystem::OnLevelAddedToWorld(ULevel* Level, UWorld* World)
+{
+    if (!Level || !World || World->GetGameInstance() != GetGameInstance() || Level == World->PersistentLevel) return;
+    
+    // World Partition cells stream in as levels too, so one hook covers both.
+    FBox Bounds = ALevelBounds::CalculateLevelBounds(Level);
+    if (!Bounds.IsValid) return;
+    
+    FString PackageName = UWorld::RemovePIEPrefix(Level->GetOutermost()->GetName());
+    FName PartitionName(*PackageName);
+    {
+        FReadScopeLock Lock(PartitionLock);
+        if (Partitions.Contains(PartitionName)) return;
+    }
+    
+    FString FileName = PackageName;
+    FileName.RemoveFromStart(TEXT("/"));
+    FileName.ReplaceInline(TEXT("/"), TEXT("_"));
+    FLightLockConfig PartitionConfig = Configuration;
+    PartitionConfig.CachePath = FPaths::GetPath(Configuration.CachePath) / TEXT("Levels") / FPaths::MakeValidFileName(FileName) + TEXT(".bin");
+    
+    PartitionConfig.Environment = ActiveEnvironment;
+    
+    FLevelPartition Partition;
+    Partition.Core = MakeUnique<FLightLockCore>(PartitionConfig);
+    if (EnvironmentBlendAlpha > 0.0f)
+    {
+        Partition.Core->SetEnvironment(ActiveEnvironment, BlendEnvironment, EnvironmentBlendAlpha);
+    }
+    Partition.Bounds = Bounds;
+    Partition.World = World;
+    {
+        FWriteScopeLock Lock(PartitionLock);
+        Partitions.Add(PartitionName, MoveTemp(Partition));
+    }
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Partition %s loaded"), *PackageName);
+}
+
+void ULightLockSubsystem::OnLevelRemovedFromWorld(ULevel* Level, UWorld* World)
+{
+    if (World && World->GetGameInstance() != GetGameInstance()) return;
+    
+    // A null level means the whole world is going away.
+    FName PartitionName = Level ? FName(*UWorld::RemovePIEPrefix(Level->GetOutermost()->GetName())) : NAME_None;
+    TWeakObjectPtr<UWorld> WeakWorld(World);
+    TArray<TUniquePtr<FLightLockCore>> Released;
+    {
+        FWriteScopeLock Lock(PartitionLock);
+        for (auto It = Partitions.CreateIterator(); It; ++It)
+        {
+            if (Level ? It.Key() == PartitionName : It.Value().World == WeakWorld)
+            {
+                UE_LOG(LogTemp, Log, TEXT("LightLock: Partition %s released"), *It.Key().ToString());
+                Released.Add(MoveTemp(It.Value().Core));
+                It.RemoveCurrent();
+            }
+        }
+    }
+    // Destroying a core drains its queue and saves it to its own file; do that outside the lock.
+    Released.Empty();
+}
+
+FLightLockCore* ULightLockSubsystem::FindCoreLocked(const FVector& Position) const
+{
+    FLightLockCore* Best = Core.Get();
+    double BestVolume = TNumericLimits<double>::Max();
+    for (const auto& Pair : Partitions)
+    {
+        if (Pair.Value.Bounds.IsInsideOrOn(Position))
+        {
+            double Volume = Pair.Value.Bounds.GetVolume();
+            if (Volume < BestVolume)
+            {
+                BestVolume = Volume;
+                Best = Pair.Value.Core.Get();
+            }
+        }
+    }
+    return Best;
+}
+
+FLightLockCore* ULightLockSubsystem::GetCoreForPosition(const FVector& Position) const
+{
+    FReadScopeLock Lock(PartitionLock);
+    return FindCoreLocked(Position);
+}
+
+template<typename FunctionType>
+void ULightLockSubsystem::ForEachCore(FunctionType&& Function) const
+{
+    FReadScopeLock Lock(PartitionLock);
+    if (Core.IsValid()) Function(*Core);
+    for (const auto& Pair : Partitions)
+    {
+        Function(*Pair.Value.Core);
+    }
+}
+
+void ULightLockSubsystem::OnEndFrame()
+{
+    ForEachCore([](FLightLockCore& Target) { Target.AdvanceFrame(); });
+}
+
+int32 ULightLockSubsystem::GetLevelPartitionCount() const
+{
+    FReadScopeLock Lock(PartitionLock);
+    return Partitions.Num();
+}
+
 bool ULightLockSubsystem::QueryLighting(FVector Position, FVector Normal, FLinearColor& OutColor, float& OutWeight)
 {
-    if (!Core.IsValid()) return false;
+    FReadScopeLock Lock(PartitionLock);
+    FLightLockCore* Target = FindCoreLocked(Position);
+    if (!Target) return false;
     uint32 Hash = FLightLockHasher::HashWorldSpace(Position, Normal, Configuration.WorldSpacePrecision);
-    return Core->Query(Hash, Position, Normal, OutColor, OutWeight);
+    return Target->Query(Hash, Position, Normal, OutColor, OutWeight);
+}
+
+int32 ULightLockSubsystem::QueryLightingBatch(const TArray<FVector>& Positions, const TArray<FVector>& Normals, TArray<FLinearColor>& OutColors, TArray<float>& OutWeights, bool bInterpolate)
+{
+    OutColors.SetNumUninitialized(Positions.Num());
+    OutWeights.SetNumUninitialized(Positions.Num());
+    if (Positions.Num() == 0) return 0;
+    if (Normals.Num() != Positions.Num() && Normals.Num() != 1)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: QueryLightingBatch needs one normal per position or a single normal"));
+        for (int32 i = 0; i < Positions.Num(); ++i)
+        {
+            OutColors[i] = FLinearColor::Black;
+            OutWeights[i] = 0.0f;
+        }
+        return 0;
+    }
+    return SampleLighting(Positions, Normals, OutColors, OutWeights, bInterpolate);
+}
+
+int32 ULightLockSubsystem::SampleLighting(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TArrayView<FLinearColor> OutColors, TArrayView<float> OutWeights, bool bInterpolate) const
+{
+    FReadScopeLock Lock(PartitionLock);
+    if (Partitions.Num() == 0)
+    {
+        if (Core.IsValid()) return Core->QueryBatch(Positions, Normals, OutColors, OutWeights, bInterpolate);
+        for (int32 i = 0; i < Positions.Num(); ++i)
+        {
+            OutColors[i] = FLinearColor::Black;
+            OutWeights[i] = 0.0f;
+        }
+        return 0;
+    }
+    
+    // Group the points by owning core, then gather, query and scatter each group.
+    TMap<FLightLockCore*, TArray<int32>> Groups;
+    for (int32 i = 0; i < Positions.Num(); ++i)
+    {
+        Groups.FindOrAdd(FindCoreLocked(Positions[i])).Add(i);
+    }
+    int32 Hits = 0;
+    TArray<FVector> GroupPositions;
+    TArray<FVector> GroupNormals;
+    TArray<FLinearColor> GroupColors;
+    TArray<float> GroupWeights;
+    for (const auto& Pair : Groups)
+    {
+        const TArray<int32>& Indices = Pair.Value;
+        if (!Pair.Key)
+        {
+            for (int32 i : Indices)
+            {
+                OutColors[i] = FLinearColor::Black;
+                OutWeights[i] = 0.0f;
+            }
+            continue;
+        }
+        if (Indices.Num() == Positions.Num())
+        {
+            return Pair.Key->QueryBatch(Positions, Normals, OutColors, OutWeights, bInterpolate);
+        }
+        GroupPositions.Reset(Indices.Num());
+        GroupNormals.Reset(Normals.Num() == 1 ? 1 : Indices.Num());
+        for (int32 i : Indices)
+        {
+            GroupPositions.Add(Positions[i]);
+            if (Normals.Num() != 1) GroupNormals.Add(Normals[i]);
+        }
+        if (Normals.Num() == 1) GroupNormals.Add(Normals[0]);
+        GroupColors.SetNumUninitialized(Indices.Num());
+        GroupWeights.SetNumUninitialized(Indices.Num());
+        Hits += Pair.Key->QueryBatch(GroupPositions, GroupNormals, GroupColors, GroupWeights, bInterpolate);
+        for (int32 j = 0; j < Indices.Num(); ++j)
+        {
+            OutColors[Indices[j]] = GroupColors[j];
+            OutWeights[Indices[j]] = GroupWeights[j];
+        }
+    }
+    return Hits;
 }
 
 void ULightLockSubsystem::StoreLighting(FVector Position, FVector Normal, FLinearColor Color, float Weight, bool bIsStatic, int32 BounceCount, float Confidence)
 {
-    if (!Core.IsValid()) return;
+    FReadScopeLock Lock(PartitionLock);
+    FLightLockCore* Target = FindCoreLocked(Position);
+    if (!Target) return;
     uint32 Hash = FLightLockHasher::HashWorldSpace(Position, Normal, Configuration.WorldSpacePrecision);
-    Core->Store(Hash, Color, Weight, Position, Normal, bIsStatic, static_cast<uint8>(BounceCount), Confidence);
+    Target->Store(Hash, Color, Weight, Position, Normal, bIsStatic, static_cast<uint8>(BounceCount), Confidence);
 }
 
 void ULightLockSubsystem::InvalidateRegion(FBox Region)
 {
+    FReadScopeLock Lock(PartitionLock);
     if (Core.IsValid()) Core->InvalidateRegion(Region);
+    for (const auto& Pair : Partitions)
+    {
+        if (Pair.Value.Bounds.Intersect(Region))
+        {
+            Pair.Value.Core->InvalidateRegion(Region);
+        }
+    }
 }
 
 void ULightLockSubsystem::InvalidateSphere(FVector Center, float Radius)
 {
-    if (Core.IsValid()) Core->InvalidateSphere(Center, Radius);
+    InvalidateRegion(FBox(Center - FVector(Radius), Center + FVector(Radius)));
 }
 
 void ULightLockSubsystem::UpdateCamera(FVector CameraPosition, FVector CameraForward, float FOV, float FarPlane, float DeltaTime)
 {
-    if (Core.IsValid()) Core->UpdateCamera(CameraPosition, CameraForward, FOV, FarPlane, DeltaTime);
+    ForEachCore([&](FLightLockCore& Target) { Target.UpdateCamera(CameraPosition, CameraForward, FOV, FarPlane, DeltaTime); });
+}
+
+void ULightLockSubsystem::SetLoadFocus(FVector Position)
+{
+    ForEachCore([&](FLightLockCore& Target) { Target.SetLoadFocus(Position); });
 }
 
 void ULightLockSubsystem::CullDistantEntries(FVector CameraPosition, float MaxDistance)
 {
-    if (Core.IsValid()) Core->CullDistantEntries(CameraPosition, MaxDistance);
+    ForEachCore([&](FLightLockCore& Target) { Target.CullDistantEntries(CameraPosition, MaxDistance); });
 }
 
 void ULightLockSubsystem::FlushCache()
 {
-    if (Core.IsValid()) Core->Flush();
+    ForEachCore([](FLightLockCore& Target) { Target.Flush(); });
 }
 
 void ULightLockSubsystem::ClearDynamicCache()
 {
-    if (Core.IsValid()) Core->ClearDynamic();
+    ForEachCore([](FLightLockCore& Target) { Target.ClearDynamic(); });
 }
 
 void ULightLockSubsystem::ClearAllCaches()
 {
-    if (Core.IsValid()) Core->ClearAll();
+    ForEachCore([](FLightLockCore& Target) { Target.ClearAll(); });
 }
 
 FLightLockStats ULightLockSubsystem::GetStatistics() const
 {
-    if (Core.IsValid()) return Core->GetStats();
-    return FLightLockStats();
+    FLightLockStats Result;
+    ForEachCore([&Result](FLightLockCore& Target) { AccumulateStats(Result, Target.GetStats()); });
+    return Result;
 }
 
 void ULightLockSubsystem::ResetStatistics()
 {
-    if (Core.IsValid()) Core->ResetStats();
+    ForEachCore([](FLightLockCore& Target) { Target.ResetStats(); });
+}
+
+void ULightLockSubsystem::SetLightingEnvironment(FLightLockEnvironmentKey Environment, FLightLockEnvironmentKey InBlendEnvironment, float BlendAlpha)
+{
+    ActiveEnvironment = Environment;
+    BlendEnvironment = InBlendEnvironment;
+    EnvironmentBlendAlpha = BlendAlpha;
+    ForEachCore([&](FLightLockCore& Target) { Target.SetEnvironment(Environment, InBlendEnvironment, BlendAlpha); });
+}
+
+void ULightLockSubsystem::PreloadLightingEnvironment(FLightLockEnvironmentKey Environment)
+{
+    ForEachCore([&](FLightLockCore& Target) { Target.PreloadEnvironment(Environment); });
+}
+
+void ULightLockSubsystem::ReleaseLightingEnvironment(FLightLockEnvironmentKey Environment)
+{
+    ForEachCore([&](FLightLockCore& Target) { Target.ReleaseEnvironment(Environment); });
+}
+
+void ULightLockSubsystem::SetCacheCapacities(int32 StaticCapacity, int32 DynamicCapacity)
+{
+    {
+        // Partitions loaded from now on copy Configuration.
+        FWriteScopeLock Lock(PartitionLock);
+        Configuration.StaticCapacity = FMath::Max(StaticCapacity, 1);
+        Configuration.DynamicCapacity = FMath::Max(DynamicCapacity, 1);
+    }
+    ForEachCore([this](FLightLockCore& Target) { Target.SetCapacities(Configuration.StaticCapacity, Configuration.DynamicCapacity); });
+}
+
+void ULightLockSubsystem::SetWorldSpacePrecision(float Precision)
+{
+    {
+        // Queries and stores read the precision under the read lock.
+        FWriteScopeLock Lock(PartitionLock);
+        Configuration.WorldSpacePrecision = FMath::Max(Precision, KINDA_SMALL_NUMBER);
+    }
+    ForEachCore([this](FLightLockCore& Target) { Target.SetWorldSpacePrecision(Configuration.WorldSpacePrecision); });
+}
+
+FLightLockEnvironmentKey ULightLockSubsystem::MakeLightingEnvironment(float TimeOfDayHours, int32 BucketsPerDay, const TArray<FName>& EnabledLights)
+{
+    return FLightLockHasher::MakeEnvironmentKey(TimeOfDayHours, BucketsPerDay, EnabledLights);
+}
+
+void ULightLockSubsystem::StartTrace(int32 MaxTraceMegabytes)
+{
+    if (Core.IsValid()) Core->StartTrace(static_cast<int64>(FMath::Max(MaxTraceMegabytes, 1)) * 1024 * 1024);
+}
+
+bool ULightLockSubsystem::StopTrace(const FString& FileName)
+{
+    if (!Core.IsValid()) return false;
+    Core->StopTrace();
+    return Core->SaveTrace(FPaths::ProjectSavedDir() / TEXT("LightLock/Traces") / FileName);
+}
+
+int64 ULightLockSubsystem::ExportLightingDelta(int64 SinceEpoch, TArray<uint8>& OutBytes) const
+{
+    OutBytes.Reset();
+    if (!Core.IsValid()) return SinceEpoch;
+    if (Configuration.bEnableLevelPartitions)
+    {
+        // Each partition keeps its own epochs, so one SinceEpoch cannot describe them all.
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: lighting deltas are not supported with level partitions enabled"));
+        return SinceEpoch;
+    }
+    return static_cast<int64>(Core->ExportDelta(static_cast<uint64>(FMath::Max<int64>(SinceEpoch, 0)), OutBytes));
+}
+
+bool ULightLockSubsystem::ImportLightingDelta(const TArray<uint8>& Bytes)
+{
+    if (!Core.IsValid()) return false;
+    if (Configuration.bEnableLevelPartitions)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("LightLock: lighting deltas are not supported with level partitions enabled"));
+        return false;
+    }
+    return Core->ImportDelta(Bytes).bAccepted;
+}
+
+int64 ULightLockSubsystem::SaveLightingDelta(const FString& FileName, int64 SinceEpoch) const
+{
+    if (Configuration.bEnableLevelPartitions) return -1;
+    TArray<uint8> Bytes;
+    int64 Epoch = ExportLightingDelta(SinceEpoch, Bytes);
+    if (!FFileHelper::SaveArrayToFile(Bytes, *(FPaths::ProjectSavedDir() / TEXT("LightLock/Deltas") / FileName))) return -1;
+    return Epoch;
+}
+
+bool ULightLockSubsystem::LoadLightingDelta(const FString& FileName)
+{
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *(FPaths::ProjectSavedDir() / TEXT("LightLock/Deltas") / FileName))) return false;
+    return ImportLightingDelta(Bytes);
 }
@@ -0,0 +1,280 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "LightLockTrace.h"
+#include "LightLockEncoding.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Math/Float16.h"
+#include "Serialization/Archive.h"
+
+static constexpr uint32 LIGHTLOCK_TRACE_MAGIC = 0x4C4C5452;
+static constexpr uint32 LIGHTLOCK_TRACE_VERSION = 1;
+static constexpr double TRACE_POSITION_QUANTUM = 0.01;
+static constexpr uint8 TRACE_OP_MASK = 0x0F;
+static constexpr uint8 TRACE_FLAG_HIT = 0x10;
+static constexpr uint8 TRACE_FLAG_STATIC = 0x20;
+
+using namespace LightLockEncoding;
+
+static int64 QuantizeTracePosition(double Value)
+{
+    return FMath::RoundToInt64(Value / TRACE_POSITION_QUANTUM);
+}
+
+static void WritePositionDelta(TArray<uint8>& Out, const FVector& Position, int64 (&Prev)[3])
+{
+    int64 Quantized[3] = { QuantizeTracePosition(Position.X), QuantizeTracePosition(Position.Y), QuantizeTracePosition(Position.Z) };
+    for (int32 Axis = 0; Axis < 3; ++Axis)
+    {
+        WriteSignedVarInt(Out, Quantized[Axis] - Prev[Axis]);
+        Prev[Axis] = Quantized[Axis];
+    }
+}
+
+static bool ReadPositionDelta(FReader& Reader, FVector& OutPosition, int64 (&Prev)[3])
+{
+    for (int32 Axis = 0; Axis < 3; ++Axis)
+    {
+        int64 Delta;
+        if (!Reader.ReadSignedVarInt(Delta)) return false;
+        Prev[Axis] += Delta;
+    }
+    OutPosition = FVector(Prev[0] * TRACE_POSITION_QUANTUM, Prev[1] * TRACE_POSITION_QUANTUM, Prev[2] * TRACE_POSITION_QUANTUM);
+    return true;
+}
+
+static void WriteAbsolutePosition(TArray<uint8>& Out, const FVector& Position)
+{
+    WriteSignedVarInt(Out, QuantizeTracePosition(Position.X));
+    WriteSignedVarInt(Out, QuantizeTracePosition(Position.Y));
+    WriteSignedVarInt(Out, QuantizeTracePosition(Position.Z));
+}
+
+static bool ReadAbsolutePosition(FReader& Reader, FVector& OutPosition)
+{
+    int64 Quantized[3] = {};
+    for (int32 Axis = 0; Axis < 3; ++Axis)
+    {
+        if (!Reader.ReadSignedVarInt(Quantized[Axis])) return false;
+    }
+    OutPosition = FVector(Quantized[0] * TRACE_POSITION_QUANTUM, Quantized[1] * TRACE_POSITION_QUANTUM, Quantized[2] * TRACE_POSITION_QUANTUM);
+    return true;
+}
+
+// Same 1/1000 quantization as FLightLockHasher, so replayed normals rehash identically.
+static void WriteNormal(TArray<uint8>& Out, const FVector& Normal)
+{
+    WriteRaw(Out, static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Normal.X * 1000.0f), -32768, 32767)));
+    WriteRaw(Out, static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Normal.Y * 1000.0f), -32768, 32767)));
+    WriteRaw(Out, static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Normal.Z * 1000.0f), -32768, 32767)));
+}
+
+static bool ReadNormal(FReader& Reader, FVector& OutNormal)
+{
+    int16 X, Y, Z;
+    if (!Reader.ReadRaw(X) || !Reader.ReadRaw(Y) || !Reader.ReadRaw(Z)) return false;
+    OutNormal = FVector(X / 1000.0f, Y / 1000.0f, Z / 1000.0f);
+    return true;
+}
+
+FLightLockTraceRecorder::FLightLockTraceRecorder(int64 InMaxBytes, float InWorldSpacePrecision)
+    : MaxBytes(FMath::Max<int64>(InMaxBytes, CHUNK_SIZE))
+    , WorldSpacePrecision(InWorldSpacePrecision)
+{
+}
+
+void FLightLockTraceRecorder::BeginChunk()
+{
+    if (Chunks.Num() > 0 && static_cast<int64>(Chunks.Num() + 1) * CHUNK_SIZE > MaxBytes)
+    {
+        Chunks.RemoveAt(0);
+        DroppedChunks++;
+    }
+    TArray<uint8>& Chunk = Chunks.AddDefaulted_GetRef();
+    Chunk.Reserve(CHUNK_SIZE + 64);
+    FMemory::Memzero(PrevPosition);
+    FMemory::Memzero(PrevCameraPosition);
+}
+
+void FLightLockTraceRecorder::Record(const FLightLockTraceEvent& Event)
+{
+    FScopeLock Lock(&Mutex);
+    if (Chunks.Num() == 0 || Chunks.Last().Num() >= CHUNK_SIZE)
+    {
+        BeginChunk();
+    }
+    TArray<uint8>& Out = Chunks.Last();
+
+    uint8 Header = static_cast<uint8>(Event.Op) & TRACE_OP_MASK;
+    if (Event.bHit) Header |= TRACE_FLAG_HIT;
+    if (Event.bIsStatic) Header |= TRACE_FLAG_STATIC;
+    Out.Add(Header);
+
+    switch (Event.Op)
+    {
+    case ELightLockTraceOp::Query:
+        WriteRaw(Out, Event.Hash);
+        WritePositionDelta(Out, Event.Position, PrevPosition);
+        WriteNormal(Out, Event.Normal);
+        break;
+    case ELightLockTraceOp::Store:
+        WriteRaw(Out, Event.Hash);
+        WritePositionDelta(Out, Event.Position, PrevPosition);
+        WriteNormal(Out, Event.Normal);
+        WriteRaw(Out, FFloat16(Event.Color.R));
+        WriteRaw(Out, FFloat16(Event.Color.G));
+        WriteRaw(Out, FFloat16(Event.Color.B));
+        WriteRaw(Out, FFloat16(Event.Color.A));
+        WriteRaw(Out, Event.Weight);
+        WriteRaw(Out, static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Event.Confidence * 255.0f), 0, 255)));
+        WriteRaw(Out, Event.BounceCount);
+        break;
+    case ELightLockTraceOp::InvalidateRegion:
+        WriteAbsolutePosition(Out, Event.Region.Min);
+        WriteAbsolutePosition(Out, Event.Region.Max);
+        break;
+    case ELightLockTraceOp::UpdateCamera:
+        WritePositionDelta(Out, Event.Position, PrevCameraPosition);
+        WriteNormal(Out, Event.Normal);
+        WriteRaw(Out, Event.FOV);
+        WriteRaw(Out, Event.FarPlane);
+        WriteRaw(Out, Event.DeltaTime);
+        break;
+    case ELightLockTraceOp::CullDistantEntries:
+        WriteAbsolutePosition(Out, Event.Position);
+        WriteRaw(Out, Event.MaxDistance);
+        break;
+    default:
+        break;
+    }
+}
+
+bool FLightLockTraceRecorder::SaveToFile(const FString& FilePath) const
+{
+    TArray<TArray<uint8>> Snapshot;
+    {
+        FScopeLock Lock(&Mutex);
+        Snapshot = Chunks;
+    }
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+    TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*FilePath));
+    if (!Writer) return false;
+
+    uint32 Magic = LIGHTLOCK_TRACE_MAGIC;
+    uint32 Version = LIGHTLOCK_TRACE_VERSION;
+    float Precision = WorldSpacePrecision;
+    uint32 ChunkCount = Snapshot.Num();
+    *Writer << Magic << Version << Precision << ChunkCount;
+    for (TArray<uint8>& Chunk : Snapshot)
+    {
+        uint32 Size = Chunk.Num();
+        *Writer << Size;
+        Writer->Serialize(Chunk.GetData(), Size);
+    }
+    bool bOk = !Writer->IsError();
+    Writer->Close();
+    UE_LOG(LogTemp, Log, TEXT("LightLock: Saved trace with %u chunks to %s"), ChunkCount, *FilePath);
+    return bOk;
+}
+
+int64 FLightLockTraceRecorder::GetRecordedBytes() const
+{
+    FScopeLock Lock(&Mutex);
+    int64 Total = 0;
+    for (const TArray<uint8>& Chunk : Chunks)
+    {
+        Total += Chunk.Num();
+    }
+    return Total;
+}
+
+int64 FLightLockTraceRecorder::GetDroppedChunks() const
+{
+    FScopeLock Lock(&Mutex);
+    return DroppedChunks;
+}
+
+bool FLightLockTraceReader::LoadFromFile(const FString& FilePath)
+{
+    Chunks.Reset();
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FilePath));
+    if (!Reader) return false;
+
+    uint32 Magic, Version, ChunkCount;
+    *Reader << Magic << Version << WorldSpacePrecision << ChunkCount;
+    if (Magic != LIGHTLOCK_TRACE_MAGIC || Version != LIGHTLOCK_TRACE_VERSION) return false;
+
+    for (uint32 i = 0; i < ChunkCount && !Reader->IsError(); ++i)
+    {
+        uint32 Size = 0;
+        *Reader << Size;
+        if (Size > static_cast<uint32>(Reader->TotalSize() - Reader->Tell())) return false;
+        TArray<uint8>& Chunk = Chunks.AddDefaulted_GetRef();
+        Chunk.SetNumUninitialized(Size);
+        Reader->Serialize(Chunk.GetData(), Size);
+    }
+    return !Reader->IsError();
+}
+
+bool FLightLockTraceReader::ReadAll(TArray<FLightLockTraceEvent>& OutEvents) const
+{
+    for (const TArray<uint8>& Chunk : Chunks)
+    {
+        FReader Reader(Chunk.GetData(), Chunk.Num());
+        int64 PrevPosition[3] = {};
+        int64 PrevCameraPosition[3] = {};
+        while (!Reader.IsAtEnd())
+        {
+            uint8 Header;
+            if (!Reader.ReadRaw(Header)) return false;
+            uint8 Op = Header & TRACE_OP_MASK;
+            if (Op >= static_cast<uint8>(ELightLockTraceOp::Num)) return false;
+
+            FLightLockTraceEvent Event;
+            Event.Op = static_cast<ELightLockTraceOp>(Op);
+            Event.bHit = (Header & TRACE_FLAG_HIT) != 0;
+            Event.bIsStatic = (Header & TRACE_FLAG_STATIC) != 0;
+            bool bOk = true;
+            switch (Event.Op)
+            {
+            case ELightLockTraceOp::Query:
+                bOk = Reader.ReadRaw(Event.Hash) && ReadPositionDelta(Reader, Event.Position, PrevPosition) && ReadNormal(Reader, Event.Normal);
+                break;
+            case ELightLockTraceOp::Store:
+            {
+                FFloat16 R, G, B, A;
+                uint8 Confidence = 255;
+                bOk = Reader.ReadRaw(Event.Hash) && ReadPositionDelta(Reader, Event.Position, PrevPosition) && ReadNormal(Reader, Event.Normal)
+                    && Reader.ReadRaw(R) && Reader.ReadRaw(G) && Reader.ReadRaw(B) && Reader.ReadRaw(A)
+                    && Reader.ReadRaw(Event.Weight) && Reader.ReadRaw(Confidence) && Reader.ReadRaw(Event.BounceCount);
+                Event.Color = FLinearColor(R.GetFloat(), G.GetFloat(), B.GetFloat(), A.GetFloat());
+                Event.Confidence = Confidence / 255.0f;
+                break;
+            }
+            case ELightLockTraceOp::InvalidateRegion:
+            {
+                FVector Min, Max;
+                bOk = ReadAbsolutePosition(Reader, Min) && ReadAbsolutePosition(Reader, Max);
+                Event.Region = FBox(Min, Max);
+                break;
+            }
+            case ELightLockTraceOp::UpdateCamera:
+                bOk = ReadPositionDelta(Reader, Event.Position, PrevCameraPosition) && ReadNormal(Reader, Event.Normal)
+                    && Reader.ReadRaw(Event.FOV) && Reader.ReadRaw(Event.FarPlane) && Reader.ReadRaw(Event.DeltaTime);
+                break;
+            case ELightLockTraceOp::CullDistantEntries:
+                bOk = ReadAbsolutePosition(Reader, Event.Position) && Reader.ReadRaw(Event.MaxDistance);
+                break;
+            default:
+                break;
+            }
+            if (!bOk) return false;
+            OutEvents.Add(Event);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Approximate set of the most often and most recently hit static hashes, saved with the cache so the
+// next start loads them first. Fixed size and set-associative: a hash maps to one set of WAYS slots and
+// a hash not yet tracked replaces the set's lowest-scoring slot, so one-off hits don't displace regulars.
+// A slot's score is its hit count halved every HALF_LIFE_FRAMES since its last hit.
+// Not thread-safe: guarded by the static table's lock.
+class LIGHTLOCK_API FLightLockAccessTracker
+{
+    struct FSlot;
+
+public:
+    // Point-in-time copy that can be read on another thread. Shares the slots until the tracker next
+    // records a hit, which copies them only if the snapshot is still alive.
+    class FSnapshot
+    {
+    public:
+        void GetHotSet(uint32 Frame, TArray<uint32>& OutHashes) const;
+
+    private:
+        friend class FLightLockAccessTracker;
+        TSharedPtr<const TArray<FSlot>> Slots;
+    };
+
+    explicit FLightLockAccessTracker(int32 InNumSlots = 16384);
+
+    void Record(uint32 Hash, uint32 Frame);
+    // Tracked hashes, highest score first.
+    void GetHotSet(uint32 Frame, TArray<uint32>& OutHashes) const;
+    void Reset();
+    FSnapshot Snapshot() const;
+    SIZE_T GetAllocatedBytes() const { return Slots->GetAllocatedSize(); }
+
+private:
+    static constexpr int32 WAYS = 4;
+    static constexpr float HALF_LIFE_FRAMES = 3600.0f;
+
+    struct FSlot
+    {
+        uint32 Hash = 0;
+        uint32 LastFrame = 0;
+        // Zero marks an empty slot.
+        uint32 Hits = 0;
+    };
+
+    static float GetScore(const FSlot& Slot, uint32 Frame);
+    static void CollectHotSet(const TArray<FSlot>& InSlots, uint32 Frame, TArray<uint32>& OutHashes);
+
+    TSharedPtr<TArray<FSlot>> Slots;
+    uint32 SetShift = 32;
+};
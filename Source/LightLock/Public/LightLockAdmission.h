@@ -0,0 +1,35 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// TinyLFU admission filter: a count-min sketch of recent query frequency. When a store would evict,
+// the candidate is admitted only if it has been asked for more often than the victim it replaces.
+// Counters are 4 bits, packed 16 to a word and updated lock-free. Aging halves a slice of the sketch
+// every frame, so a full halving completes every AgingFrames frames and old popularity fades.
+class LIGHTLOCK_API FLightLockAdmissionFilter
+{
+public:
+    FLightLockAdmissionFilter(int32 InCountersPerRow, int32 InAgingFrames);
+
+    void Record(uint32 Hash);
+    uint32 Estimate(uint32 Hash) const;
+    bool Admit(uint32 CandidateHash, uint32 VictimHash) const { return Estimate(CandidateHash) > Estimate(VictimHash); }
+    void Age();
+    SIZE_T GetAllocatedBytes() const { return static_cast<SIZE_T>(NumWords) * sizeof(uint64); }
+
+private:
+    static constexpr int32 DEPTH = 4;
+    static constexpr int32 COUNTERS_PER_WORD = 16;
+
+    uint32 GetCounterIndex(uint32 Hash, int32 Row) const;
+
+    TUniquePtr<std::atomic<uint64>[]> Words;
+    uint32 NumWords;
+    uint32 RowShift;
+    uint32 WordsPerRow;
+    uint32 AgingStride;
+    uint32 AgingCursor = 0;
+};
@@ -0,0 +1,78 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <cstddef>
+
+// Slab arena for cache nodes and spatial buckets.
+// Small allocations are carved from large blocks and recycled through per-size-class free lists;
+// big ones (hash bucket arrays) go to the general allocator but are still owned by the arena.
+// Reset() drops everything at once without visiting individual allocations.
+// Not thread-safe: each arena is guarded by the lock of the table that owns it.
+class LIGHTLOCK_API FLightLockArena
+{
+public:
+    explicit FLightLockArena(SIZE_T InBlockSize = 256 * 1024);
+    ~FLightLockArena();
+    
+    FLightLockArena(const FLightLockArena&) = delete;
+    FLightLockArena& operator=(const FLightLockArena&) = delete;
+    
+    void* Allocate(SIZE_T Size, SIZE_T Alignment);
+    void Free(void* Ptr, SIZE_T Size);
+    void Reset();
+    
+    SIZE_T GetAllocatedBytes() const { return Blocks.Num() * BlockSize + LargeBytes; }
+    SIZE_T GetUsedBytes() const { return UsedBytes; }
+    
+private:
+    static constexpr SIZE_T SIZE_CLASS_GRANULARITY = 16;
+    static constexpr int32 NUM_SIZE_CLASSES = 16;
+    static constexpr SIZE_T MAX_SMALL_SIZE = SIZE_CLASS_GRANULARITY * NUM_SIZE_CLASSES;
+    
+    struct FFreeNode
+    {
+        FFreeNode* Next;
+    };
+    
+    SIZE_T BlockSize;
+    TArray<uint8*> Blocks;
+    uint8* Cursor = nullptr;
+    uint8* BlockEnd = nullptr;
+    FFreeNode* FreeLists[NUM_SIZE_CLASSES] = {};
+    TSet<void*> LargeAllocations;
+    SIZE_T LargeBytes = 0;
+    SIZE_T UsedBytes = 0;
+};
+
+// Standard allocator adapter so std containers can place their nodes and buckets in an FLightLockArena.
+template<typename T>
+class TLightLockArenaAllocator
+{
+public:
+    using value_type = T;
+    
+    explicit TLightLockArenaAllocator(FLightLockArena* InArena) : Arena(InArena) {}
+    
+    template<typename U>
+    TLightLockArenaAllocator(const TLightLockArenaAllocator<U>& Other) : Arena(Other.Arena) {}
+    
+    T* allocate(std::size_t Count)
+    {
+        return static_cast<T*>(Arena->Allocate(Count * sizeof(T), alignof(T)));
+    }
+    
+    void deallocate(T* Ptr, std::size_t Count)
+    {
+        Arena->Free(Ptr, Count * sizeof(T));
+    }
+    
+    template<typename U>
+    bool operator==(const TLightLockArenaAllocator<U>& Other) const { return Arena == Other.Arena; }
+    
+    template<typename U>
+    bool operator!=(const TLightLockArenaAllocator<U>& Other) const { return Arena != Other.Arena; }
+    
+    FLightLockArena* Arena;
+};
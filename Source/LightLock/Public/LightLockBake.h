@@ -0,0 +1,35 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+struct FLightLockBakeSample
+{
+    FVector Position = FVector::ZeroVector;
+    FVector Normal = FVector::UpVector;
+    uint32 Hash = 0;
+};
+
+struct FLightLockBakeResult
+{
+    FLinearColor Color = FLinearColor::Black;
+    float Weight = 1.0f;
+    uint8 BounceCount = 1;
+    float Confidence = 1.0f;
+};
+
+// Computes lighting for one bake sample. Called concurrently from worker threads; return false to skip the sample.
+using FLightLockBakeEvaluator = TFunction<bool(UWorld* World, const FLightLockBakeSample& Sample, FLightLockBakeResult& OutResult)>;
+
+// Named evaluators for the bake commandlet (-Evaluator=<Name>). Projects register their own from module startup.
+class LIGHTLOCK_API FLightLockBakeEvaluators
+{
+public:
+    static void Register(FName Name, FLightLockBakeEvaluator Evaluator);
+    static void Unregister(FName Name);
+    static FLightLockBakeEvaluator Find(FName Name);
+    static TArray<FName> GetNames();
+};
@@ -4,10 +4,55 @@
 
 #include "CoreMinimal.h"
 #include "HAL/CriticalSection.h"
+#include "Async/Future.h"
+#include "LightLockQueue.h"
+#include "LightLockArena.h"
+#include "LightLockIncrementalMap.h"
+#include "LightLockAccessTracker.h"
+#include "Misc/MemStack.h"
+#include "Math/RandomStream.h"
 #include <unordered_map>
 #include <atomic>
 #include "LightLockCore.generated.h"
 
+class FLightLockTraceRecorder;
+struct FLightLockTraceEvent;
+class FLightLockMemoryGovernor;
+class FLightLockSharedCache;
+class FLightLockAdmissionFilter;
+
+#ifndef LIGHTLOCK_ENABLE_INSTRUMENTATION
+#define LIGHTLOCK_ENABLE_INSTRUMENTATION !UE_BUILD_SHIPPING
+#endif
+
+// Identifies the lighting setup a static entry was captured under (time-of-day bucket and enabled-light set).
+// The default key is the single environment used when variants aren't needed and maps to the plain cache file.
+USTRUCT(BlueprintType)
+struct FLightLockEnvironmentKey
+{
+    GENERATED_BODY()
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 TimeOfDayBucket = 0;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 LightSetHash = 0;
+    
+    bool IsDefault() const { return TimeOfDayBucket == 0 && LightSetHash == 0; }
+    bool operator==(const FLightLockEnvironmentKey& Other) const { return TimeOfDayBucket == Other.TimeOfDayBucket && LightSetHash == Other.LightSetHash; }
+    bool operator!=(const FLightLockEnvironmentKey& Other) const { return !(*this == Other); }
+    friend uint32 GetTypeHash(const FLightLockEnvironmentKey& Key) { return HashCombine(::GetTypeHash(Key.TimeOfDayBucket), ::GetTypeHash(Key.LightSetHash)); }
+};
+
+UENUM(BlueprintType)
+enum class ELightLockAdmissionPolicy : uint8
+{
+    // Every store is admitted, evicting the weakest entry when the layer is full.
+    Always,
+    // A store that would evict is admitted only if its hash was queried more often than the victim's.
+    TinyLFU
+};
+
 USTRUCT(BlueprintType)
 struct FLightLockConfig
 {
@@ -36,6 +81,66 @@ struct FLightLockConfig
     
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
     int32 PromotionFrameThreshold = 300;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 MemoryBudgetMB = 0;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    float StaticBudgetFraction = 0.8f;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    bool bAdaptiveBudget = true;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    bool bEnableStoreQueue = false;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 StoreQueueCapacity = 65536;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    bool bEnableLevelPartitions = false;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    FLightLockEnvironmentKey Environment;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 MaxResidentEnvironments = 2;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    bool bEnableSharedStaticCache = false;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    FString SharedCacheName = TEXT("LightLock");
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    ELightLockAdmissionPolicy AdmissionPolicy = ELightLockAdmissionPolicy::Always;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 AdmissionSketchWidth = 65536;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 AdmissionAgingFrames = 600;
+    
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LightLock")
+    int32 ConfidenceHalfLifeFrames = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FLightLockLatency
+{
+    GENERATED_BODY()
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 Count = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    float P50Microseconds = 0.0f;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    float P99Microseconds = 0.0f;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    float MaxMicroseconds = 0.0f;
 };
 
 USTRUCT(BlueprintType)
@@ -66,6 +171,70 @@ struct FLightLockStats
     
     UPROPERTY(BlueprintReadOnly, Category = "LightLock")
     int64 SpatialInvalidations = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 Evictions = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 MemoryUsageBytes = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 MemoryBudgetBytes = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int32 StaticCapacity = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int32 DynamicCapacity = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 QueuedStores = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 DroppedStores = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 PendingStores = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 SharedCount = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 SharedHits = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    int64 AdmissionRejects = 0;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    bool bSharedCacheOwner = false;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency QueryLatency;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency StoreLatency;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency EvictionLatency;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency InvalidateLatency;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency CullLatency;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency SaveLatency;
+    
+    // One sample per QueryBatch call, not per point.
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency QueryBatchLatency;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency StaticLockWait;
+    
+    UPROPERTY(BlueprintReadOnly, Category = "LightLock")
+    FLightLockLatency DynamicLockWait;
 };
 
 struct FLightPath
@@ -86,6 +255,200 @@ struct FLightPath
     bool ValidateNormal(const FVector& Normal) const;
 };
 
+struct FLightLockCacheEntry
+{
+    uint32 Hash = 0;
+    FLightPath Path;
+};
+
+// First entry of a run of Morton-adjacent entries in a cache file; see FLightLockCacheFileReader::ReadTiles.
+struct FLightLockCacheTile
+{
+    uint64 TileKey = 0;
+    uint32 FirstEntry = 0;
+};
+
+// Startup ordering saved after the tile directory: where the camera was and which entries were hottest.
+struct FLightLockLoadHints
+{
+    bool bHasCamera = false;
+    FVector CameraPosition = FVector::ZeroVector;
+    // Entry indices in the file, hottest first.
+    TArray<uint32> HotEntries;
+};
+
+// Outcome of FLightLockCore::ImportDelta.
+struct FLightLockDeltaImportResult
+{
+    // False if the delta was malformed or made for another environment or precision.
+    bool bAccepted = false;
+    int32 Added = 0;
+    int32 Replaced = 0;
+    // Entries that lost the merge to an existing entry, or weren't admitted to a full layer.
+    int32 Kept = 0;
+};
+
+// Static entries packed in Morton (Z-order) of their quantized position, so neighbouring surfaces share
+// cache lines and pages. A hash index over the packed base serves point lookups. Stores of new hashes land
+// in a small arena-backed delta map and removals are tombstoned; both are folded into the base by Compact().
+// The base is immutable once built unless no snapshot shares it, which makes Snapshot() cheap.
+// Once the delta or tombstones outgrow a fraction of the base, the fold runs on the thread pool: the delta
+// is frozen for the builder, later changes go to a fresh delta plus a removal journal, and Tick() swaps the
+// new base in and replays the journal, so stores never pay for a rebuild.
+class FLightLockStaticTable
+{
+    struct FBase;
+    struct FDeltaRef
+    {
+        uint64 Code;
+        uint32 Hash;
+        const FLightPath* Path;
+    };
+    
+public:
+    // Approximate bytes per entry (packed arrays plus index at half load), used to seed the memory governor.
+    static constexpr SIZE_T ESTIMATED_BYTES_PER_ENTRY = sizeof(uint64) + sizeof(uint32) + sizeof(FLightPath) + 2 * sizeof(uint32);
+    
+    // Point-in-time view that can be read on another thread without the table's lock. Shares a packed base
+    // by reference: taking one starts folding the delta and tombstones into a new base on the thread pool,
+    // and the reader waits for that build. Only entries changed while an earlier build was already running
+    // are copied.
+    class FSnapshot
+    {
+    public:
+        // Both wait for the shared build, if one is running.
+        int32 Num() const;
+        
+        template<typename FuncType>
+        void ForEach(FuncType&& Func) const
+        {
+            TBitArray<> Removed;
+            const FBase* SnapshotBase = Resolve(Removed);
+            TArray<FDeltaRef> DeltaOrder;
+            DeltaOrder.Reserve(Delta.Num());
+            for (const FLightLockCacheEntry& Entry : Delta)
+            {
+                DeltaOrder.Add({ GetMortonCode(Entry.Path), Entry.Hash, &Entry.Path });
+            }
+            ForEachMerged(SnapshotBase, Removed, DeltaOrder, Func);
+        }
+        
+    private:
+        friend class FLightLockStaticTable;
+        // Returns the shared base with the entries changed since its build started tombstoned.
+        const FBase* Resolve(TBitArray<>& OutRemoved) const;
+        TSharedPtr<const FBase> Base;
+        TSharedFuture<TSharedPtr<FBase>> PendingBase;
+        // Hashes removed or overwritten since PendingBase started, and the entries stored since.
+        TArray<uint32> Shadowed;
+        TArray<FLightLockCacheEntry> Delta;
+    };
+    
+    FLightLockStaticTable();
+    ~FLightLockStaticTable();
+    
+    const FLightPath* Find(uint32 Hash) const;
+    void Add(uint32 Hash, const FLightPath& Path);
+    bool Remove(uint32 Hash);
+    int32 Num() const { return GetBaseNum() - NumRemoved + static_cast<int32>(Frozen.size()) - NumFrozenRemoved + static_cast<int32>(Delta.size()); }
+    void Reset();
+    // Folds everything into the base now, waiting for a background compaction in flight.
+    void Compact();
+    // Swaps in a finished background compaction. Call regularly from the owner's lock.
+    void Tick();
+    bool IsCompacting() const { return PendingBase.IsValid(); }
+    FSnapshot Snapshot();
+    SIZE_T GetAllocatedBytes() const;
+    
+    static uint64 GetMortonCode(const FLightPath& Path);
+    
+    // Visits live entries in Morton order.
+    template<typename FuncType>
+    void ForEach(FuncType&& Func) const
+    {
+        TArray<FDeltaRef> DeltaOrder;
+        DeltaOrder.Reserve(Delta.size() + Frozen.size());
+        for (const auto& Pair : Delta)
+        {
+            DeltaOrder.Add({ GetMortonCode(Pair.second), Pair.first, &Pair.second });
+        }
+        for (const auto& Pair : Frozen)
+        {
+            if (IsLiveFrozen(Pair.first)) DeltaOrder.Add({ GetMortonCode(Pair.second), Pair.first, &Pair.second });
+        }
+        ForEachMerged(Base.Get(), BaseRemoved, DeltaOrder, Func);
+    }
+    
+    // Visits up to NumSamples live entries picked at random, unordered and possibly repeated. Costs
+    // O(NumSamples) whatever the table size, for callers that only need an approximate minimum.
+    void ForEachSample(int32 NumSamples, FRandomStream& Random, TFunctionRef<void(uint32 Hash, const FLightPath& Path)> Func) const;
+    
+private:
+    static constexpr int32 MIN_COMPACT_DELTA = 4096;
+    
+    using DeltaMap = std::unordered_map<uint32, FLightPath, std::hash<uint32>, std::equal_to<uint32>, TLightLockArenaAllocator<std::pair<const uint32, FLightPath>>>;
+    
+    // Sorted by Codes. Entries overwritten in place keep their slot even if their code drifts slightly.
+    struct FBase
+    {
+        TArray<uint64> Codes;
+        TArray<uint32> Hashes;
+        TArray<FLightPath> Paths;
+        
+        // Open-addressed hash -> index + 1 (0 is empty). Tombstoned entries stay indexed until Compact().
+        TArray<uint32> Index;
+        uint32 IndexMask = 0;
+        uint32 IndexShift = 32;
+        
+        int32 Find(uint32 Hash) const;
+        void BuildIndex();
+    };
+    
+    template<typename FuncType>
+    static void ForEachMerged(const FBase* MergeBase, const TBitArray<>& Removed, TArray<FDeltaRef>& DeltaOrder, FuncType& Func)
+    {
+        DeltaOrder.Sort([](const FDeltaRef& A, const FDeltaRef& B) { return A.Code < B.Code; });
+        int32 DeltaIndex = 0;
+        int32 BaseNum = MergeBase ? MergeBase->Hashes.Num() : 0;
+        for (int32 i = 0; i < BaseNum; ++i)
+        {
+            for (; DeltaIndex < DeltaOrder.Num() && DeltaOrder[DeltaIndex].Code < MergeBase->Codes[i]; ++DeltaIndex)
+            {
+                Func(DeltaOrder[DeltaIndex].Hash, *DeltaOrder[DeltaIndex].Path);
+            }
+            if (!Removed[i]) Func(MergeBase->Hashes[i], MergeBase->Paths[i]);
+        }
+        for (; DeltaIndex < DeltaOrder.Num(); ++DeltaIndex)
+        {
+            Func(DeltaOrder[DeltaIndex].Hash, *DeltaOrder[DeltaIndex].Path);
+        }
+    }
+    
+    int32 GetBaseNum() const { return Base.IsValid() ? Base->Hashes.Num() : 0; }
+    bool NeedsCompaction() const;
+    bool IsLiveFrozen(uint32 Hash) const { return !Journal.Contains(Hash); }
+    void StartCompaction();
+    void FinishCompaction();
+    void ResetDelta();
+    static TSharedPtr<FBase> BuildBase(const FBase* OldBase, const TBitArray<>& Removed, const DeltaMap& Source);
+    
+    TSharedPtr<FBase> Base;
+    TBitArray<> BaseRemoved;
+    int32 NumRemoved = 0;
+    
+    // Delta and Frozen alternate between the two arenas, so either can be dropped with an arena reset.
+    FLightLockArena DeltaArenas[2];
+    int32 DeltaArenaIndex = 0;
+    DeltaMap Delta;
+    
+    // While a compaction builds, Frozen holds the delta it was started from and is read by the builder, so
+    // it is never modified; hashes removed or overwritten since are journaled and re-applied on the swap.
+    DeltaMap Frozen;
+    TSet<uint32> Journal;
+    int32 NumFrozenRemoved = 0;
+    TSharedFuture<TSharedPtr<FBase>> PendingBase;
+};
+
 class FSpatialGrid
 {
 public:
@@ -95,15 +458,36 @@ public:
     void Insert(const FVector& Position, uint32 Hash);
     void Remove(const FVector& Position, uint32 Hash);
     TArray<uint32> QueryRegion(const FBox& Region) const;
+    void QueryRegion(const FBox& Region, TArray<uint32, TMemStackAllocator<>>& OutHashes) const;
     void Clear();
     SIZE_T GetMemoryUsage() const;
     
 private:
     static constexpr float CELL_SIZE = 1000.0f;
+    static constexpr int32 CELL_CHUNK_CAPACITY = 13;
+    
+    // Cells hold their hashes in a chain of fixed 64-byte chunks carved from the grid's arena.
+    struct CellChunk
+    {
+        CellChunk* Next;
+        uint32 Count;
+        uint32 Hashes[CELL_CHUNK_CAPACITY];
+    };
+    
+    struct CellBucket
+    {
+        CellChunk* Head = nullptr;
+    };
+    
+    using CellMap = std::unordered_map<uint64, CellBucket, std::hash<uint64>, std::equal_to<uint64>, TLightLockArenaAllocator<std::pair<const uint64, CellBucket>>>;
+    
     uint64 GetCellKey(const FVector& Position) const;
+    template<typename ArrayType>
+    void CollectRegion(const FBox& Region, ArrayType& OutHashes) const;
     
     mutable FCriticalSection Mutex;
-    std::unordered_map<uint64, TArray<uint32>> Grid;
+    FLightLockArena Arena;
+    CellMap Grid;
 };
 
 class FLightLockHasher
@@ -111,6 +495,77 @@ class FLightLockHasher
 public:
     static uint32 HashWorldSpace(const FVector& Position, const FVector& Normal, float Precision = 0.01f);
     static uint32 HashLightmapSpace(uint32 MeshID, const FVector2D& UV, uint32 LightmapResolution = 1024);
+    static uint64 MortonCode(const FVector& Position, float CellSize = 100.0f);
+    // Minimum corner of the cell a Morton code (or its top bits, shifted back into place) refers to.
+    static FVector MortonDecode(uint64 Code, float CellSize = 100.0f);
+    static FLightLockEnvironmentKey MakeEnvironmentKey(float TimeOfDayHours, int32 BucketsPerDay, TArrayView<const FName> EnabledLights);
+};
+
+// Entry-at-a-time access to the static cache format, for offline tools on files larger than memory.
+class LIGHTLOCK_API FLightLockCacheFileReader
+{
+public:
+    bool Open(const FString& FilePath);
+    bool Next(FLightLockCacheEntry& OutEntry);
+    // Positions the reader so the next call to Next returns entry EntryIndex.
+    bool SeekToEntry(uint32 EntryIndex);
+    // Reads the tile directory written after the entries. Empty for files older than v6 or written out of Morton order.
+    bool ReadTiles(TArray<FLightLockCacheTile>& OutTiles);
+    // Reads the load hints written after the tile directory. Empty for files older than v7.
+    bool ReadLoadHints(FLightLockLoadHints& OutHints);
+    const FLightLockEnvironmentKey& GetEnvironment() const { return Environment; }
+    uint32 GetCount() const { return Count; }
+
+private:
+    TUniquePtr<FArchive> Reader;
+    FLightLockEnvironmentKey Environment;
+    uint32 Version = 0;
+    uint32 Count = 0;
+    uint32 NumRead = 0;
+    int64 EntriesOffset = 0;
+};
+
+// Writes the header up front and patches the entry count on Close. Entries written in Morton order also
+// get a tile directory, so a spatial range of the file can be streamed with one seek. Output goes to a
+// temp file that replaces the target only once Close succeeds.
+class LIGHTLOCK_API FLightLockCacheFileWriter
+{
+public:
+    // Tiles group entries sharing their Morton code above this many bits (32 cells per axis).
+    static constexpr uint32 TILE_SHIFT = 15;
+    // On-disk sizes of the header, one entry (hash + serialized FLightPath) and one tile directory record.
+    static constexpr int64 HEADER_BYTES = 20;
+    static constexpr int64 ENTRY_BYTES = 70;
+    static constexpr int64 TILE_BYTES = 12;
+    // Fixed part of the trailer: tile count, then the load hints' camera and hot entry count. Each hot
+    // entry adds 4 bytes and each tile TILE_BYTES.
+    static constexpr int64 TRAILER_BYTES = 33;
+    
+    ~FLightLockCacheFileWriter();
+    
+    bool Open(const FString& FilePath, const FLightLockEnvironmentKey& InEnvironment);
+    // Optional load hints; set before writing entries. Hot hashes are given hottest first and recorded as
+    // entry indices as they are written.
+    void SetHotSet(TArrayView<const uint32> HotHashes);
+    void SetCamera(const FVector& CameraPosition);
+    void Write(const FLightLockCacheEntry& Entry);
+    bool Close();
+    uint32 GetCount() const { return Count; }
+
+private:
+    TUniquePtr<FArchive> Writer;
+    FString TargetPath;
+    FString TempPath;
+    FLightLockEnvironmentKey Environment;
+    uint32 Count = 0;
+    TArray<FLightLockCacheTile> Tiles;
+    uint64 LastCode = 0;
+    bool bMortonOrdered = true;
+    TMap<uint32, int32> HotRanks;
+    // (rank, entry index) of hot hashes written so far.
+    TArray<TPair<int32, uint32>> HotEntries;
+    bool bHasCamera = false;
+    FVector Camera = FVector::ZeroVector;
 };
 
 class LIGHTLOCK_API FLightLockCore
@@ -122,6 +577,13 @@ public:
     bool Query(uint32 Hash, const FVector& Position, const FVector& Normal, FLinearColor& OutColor, float& OutWeight);
     void Store(uint32 Hash, const FLinearColor& Color, float Weight, const FVector& Position, const FVector& Normal, bool bIsStatic, uint8 BounceCount = 1, float Confidence = 1.0f);
     
+    // Bulk lookup for particles and crowds. Hashes with the configured precision and validates like Query,
+    // but takes each lock once per QUERY_BATCH_CHUNK points and spreads chunks over worker threads. Points
+    // that miss come back black with zero weight; there is no temporal smoothing, promotion or tracing.
+    // With bInterpolate each point blends the 8 cells around it trilinearly, renormalized over the cells
+    // that hit. Normals holds one normal per point or a single one for all. Returns the number of hits.
+    int32 QueryBatch(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TArrayView<FLinearColor> OutColors, TArrayView<float> OutWeights, bool bInterpolate = false);
+    
     void InvalidateRegion(const FBox& Region);
     void InvalidateSphere(const FVector& Center, float Radius);
     
@@ -129,12 +591,51 @@ public:
     void CullDistantEntries(const FVector& CameraPosition, float MaxDistance);
     
     void AdvanceFrame();
+    void DrainStoreQueue();
     void Flush();
     void ClearDynamic();
     void ClearAll();
     
     FLightLockStats GetStats() const;
     void ResetStats();
+    SIZE_T GetMemoryUsage() const;
+    
+    void StartTrace(int64 MaxTraceBytes = 64 * 1024 * 1024);
+    void StopTrace();
+    bool IsTracing() const { return bTraceEnabled.load(std::memory_order_relaxed); }
+    bool SaveTrace(const FString& FilePath) const;
+    
+    // Selects the static variant for Key, loading it if it isn't resident. With BlendAlpha > 0 and
+    // BlendKey resident, static hits are blended towards BlendKey's entry for the same hash.
+    void SetEnvironment(const FLightLockEnvironmentKey& Key, const FLightLockEnvironmentKey& BlendKey = FLightLockEnvironmentKey(), float BlendAlpha = 0.0f);
+    void PreloadEnvironment(const FLightLockEnvironmentKey& Key);
+    void ReleaseEnvironment(const FLightLockEnvironmentKey& Key);
+    FLightLockEnvironmentKey GetEnvironment() const;
+    
+    // Where loading streams from first after the saved hot set (e.g. the spawn point). Camera updates move
+    // it too; until either arrives, loads start around the camera position recorded at the last save.
+    void SetLoadFocus(const FVector& Position);
+    
+    // Multi-instance sync. ExportDelta packs the active environment's static entries stored or promoted
+    // after SinceEpoch (0 for everything) and returns the epoch to pass next time. If the change log no
+    // longer reaches back to SinceEpoch the whole layer is sent instead. ImportDelta merges a peer's delta:
+    // a new hash is stored like any static store, an existing one is replaced only by a more confident
+    // entry (more bounces breaks a tie). Imported entries aren't logged, so two instances syncing both ways
+    // don't echo each other's entries.
+    uint64 ExportDelta(uint64 SinceEpoch, TArray<uint8>& OutBytes) const;
+    FLightLockDeltaImportResult ImportDelta(TConstArrayView<uint8> Bytes);
+    
+    // Runtime reconfiguration. Capacity changes take effect immediately; evictions from a shrink are spread
+    // over the following frames. Ignored while a memory budget is set, since the governor owns capacities.
+    void SetCapacities(int32 StaticCapacity, int32 DynamicCapacity);
+    // Re-keys dynamic entries under the new cell size over the following frames; static variants can't be
+    // re-keyed and are cleared. Callers must hash with the same precision from then on.
+    void SetWorldSpacePrecision(float Precision);
+    float GetWorldSpacePrecision() const;
+    
+    // Whole-file access to the static cache format, for offline tools.
+    static bool WriteCacheFile(const FString& FilePath, const FLightLockEnvironmentKey& Environment, TArrayView<const FLightLockCacheEntry> Entries);
+    static bool ReadCacheFile(const FString& FilePath, FLightLockEnvironmentKey& OutEnvironment, TArray<FLightLockCacheEntry>& OutEntries);
     
 private:
     struct DynamicEntry
@@ -144,36 +645,253 @@ private:
         FVector WorldPosition;
     };
     
+    struct PendingStore
+    {
+        uint32 Hash = 0;
+        FLightPath Path;
+        FVector Position = FVector::ZeroVector;
+        bool bIsStatic = false;
+    };
+    
     FLightLockConfig Config;
     std::atomic<uint32> CurrentFrame;
     
-    std::unordered_map<uint32, FLightPath> StaticCache;
-    std::unordered_map<uint32, DynamicEntry> DynamicCache;
+    std::atomic<int32> StaticCapacityLimit;
+    std::atomic<int32> DynamicCapacityLimit;
+    TUniquePtr<FLightLockMemoryGovernor> Governor;
+    FDelegateHandle MemoryTrimHandle;
+    
+    using DynamicMap = TLightLockIncrementalMap<DynamicEntry>;
+    
+    // One static table per resident lighting environment.
+    struct StaticLayer
+    {
+        explicit StaticLayer(const FLightLockEnvironmentKey& InKey);
+        
+        FLightLockEnvironmentKey Key;
+        FLightLockStaticTable Cache;
+        FLightLockAccessTracker Access;
+        uint32 LastActiveFrame = 0;
+        // Ring of (epoch, hash) for recent stores and promotions, read by ExportDelta.
+        TArray<TPair<uint64, uint32>> Changes;
+        int32 NextChange = 0;
+        // Newest epoch the ring has overwritten; exports from before it send the whole layer.
+        uint64 DroppedEpoch = 0;
+        bool bSharedReadOnly = false;
+    };
+    
+    // The dynamic table's nodes and buckets live in its own arena (guarded by the table's mutex),
+    // so clearing it is an arena reset rather than a per-node free. The arena must outlive the map.
+    // The map grows (and re-keys) incrementally, migrating a batch of entries per AdvanceFrame.
+    TMap<FLightLockEnvironmentKey, TUniquePtr<StaticLayer>> StaticLayers;
+    StaticLayer* ActiveStatic = nullptr;
+    StaticLayer* BlendStatic = nullptr;
+    float BlendAlpha = 0.0f;
+    // Last change epoch handed out; guarded by StaticMutex.
+    uint64 StaticEpoch = 0;
+    static constexpr int32 MAX_STATIC_CHANGES = 131072;
+    // Candidates drawn per store at capacity; guarded by StaticMutex.
+    static constexpr int32 STATIC_VICTIM_SAMPLES = 64;
+    FRandomStream StaticVictimRandom;
+    TUniquePtr<FLightLockSharedCache> SharedCache;
+    FLightLockArena DynamicArena;
+    DynamicMap DynamicCache;
     TUniquePtr<FSpatialGrid> SpatialIndex;
+    TUniquePtr<FLightLockAdmissionFilter> Admission;
     
     mutable FCriticalSection StaticMutex;
     mutable FCriticalSection DynamicMutex;
     
-    struct AtomicStats
+    TUniquePtr<TLightLockMpscQueue<PendingStore>> StoreQueue;
+    FCriticalSection DrainMutex;
+    TArray<PendingStore> DrainBuffer;
+    
+    enum class EStatCounter : uint8
+    {
+        TotalQueries,
+        StaticHits,
+        DynamicHits,
+        Misses,
+        Promotions,
+        CollisionsDetected,
+        SpatialInvalidations,
+        QueuedStores,
+        DroppedStores,
+        StaticEvictions,
+        DynamicEvictions,
+        SharedHits,
+        AdmissionRejects,
+        Num
+    };
+    
+    static constexpr int32 STAT_SHARD_COUNT = 32;
+    
+    struct alignas(PLATFORM_CACHE_LINE_SIZE) StatShard
+    {
+        std::atomic<uint64> Counters[static_cast<int32>(EStatCounter::Num)] = {};
+    };
+    
+    StatShard StatShards[STAT_SHARD_COUNT];
+    
+    enum class ETimedOp : uint8
     {
-        std::atomic<uint64> TotalQueries{0};
-        std::atomic<uint64> StaticHits{0};
-        std::atomic<uint64> DynamicHits{0};
-        std::atomic<uint64> Misses{0};
-        std::atomic<uint64> Promotions{0};
-        std::atomic<uint64> CollisionsDetected{0};
-        std::atomic<uint64> SpatialInvalidations{0};
-    } Stats;
+        Query,
+        Store,
+        Eviction,
+        Invalidate,
+        Cull,
+        Save,
+        QueryBatch,
+        StaticLockWait,
+        DynamicLockWait,
+        Num
+    };
+    
+#if LIGHTLOCK_ENABLE_INSTRUMENTATION
+    static constexpr int32 LATENCY_BUCKETS = 32;
+    
+    struct alignas(PLATFORM_CACHE_LINE_SIZE) LatencyShard
+    {
+        std::atomic<uint64> Buckets[static_cast<int32>(ETimedOp::Num)][LATENCY_BUCKETS] = {};
+        std::atomic<uint64> MaxNanoseconds[static_cast<int32>(ETimedOp::Num)] = {};
+    };
+    
+    mutable LatencyShard LatencyShards[STAT_SHARD_COUNT];
+    
+    struct ScopedLatency
+    {
+        ScopedLatency(const FLightLockCore& InCore, ETimedOp InOp) : Core(InCore), Op(InOp), StartCycles(FPlatformTime::Cycles64()) {}
+        ~ScopedLatency() { Core.RecordLatency(Op, FPlatformTime::Cycles64() - StartCycles); }
+        const FLightLockCore& Core;
+        ETimedOp Op;
+        uint64 StartCycles;
+    };
+    
+    class TimedScopeLock
+    {
+    public:
+        TimedScopeLock(const FLightLockCore& Core, FCriticalSection* InMutex, ETimedOp Op) : Mutex(InMutex)
+        {
+            uint64 StartCycles = FPlatformTime::Cycles64();
+            Mutex->Lock();
+            Core.RecordLatency(Op, FPlatformTime::Cycles64() - StartCycles);
+        }
+        ~TimedScopeLock() { Mutex->Unlock(); }
+    private:
+        FCriticalSection* Mutex;
+    };
+    
+    void RecordLatency(ETimedOp Op, uint64 Cycles) const;
+    FLightLockLatency ReadLatency(ETimedOp Op) const;
+    void PublishFrameStats() const;
+#endif
+    
+    static constexpr int32 SMOOTHING_SHARD_COUNT = 16;
+    
+    struct SmoothingShard
+    {
+        mutable FCriticalSection Mutex;
+        TMap<uint32, FLinearColor> PreviousColors;
+    };
+    
+    SmoothingShard SmoothingShards[SMOOTHING_SHARD_COUNT];
+    
+    std::atomic<bool> bTraceEnabled{false};
+    mutable FCriticalSection TraceMutex;
+    TUniquePtr<FLightLockTraceRecorder> TraceRecorder;
     
-    TMap<uint32, FLinearColor> PreviousColors;
     FVector PrevCameraPos;
     FVector PrevCameraDir;
     
-    void Load();
-    void LoadSync();
-    void Save() const;
-    void EvictLowestConfidenceStatic();
-    void EvictLRUOrLowConfidenceDynamic();
+    // Background loads. LoadMutex guards the task list: loads start from SetEnvironment and from a shared
+    // cache takeover in AdvanceFrame, which can run on different threads.
+    FCriticalSection LoadMutex;
+    TArray<TFuture<void>> LoadTasks;
+    // Bumped under StaticMutex when the static layers are cleared; a load started before that drops the
+    // rest of its file instead of adding stale entries.
+    std::atomic<uint32> LoadGeneration{0};
+    
+    // Last camera or explicit load focus; guarded by StaticMutex. Saved with the cache as a load hint.
+    FVector LoadFocus = FVector::ZeroVector;
+    bool bHasLoadFocus = false;
+    
+    // A cache file being loaded in priority order; see OpenLoad.
+    struct FStaticLoad;
+    static constexpr int32 LOAD_BATCH_ENTRIES = 16384;
+    
+    // Background cache writes. SaveMutex guards the task list; WriteMutex orders the writes themselves.
+    mutable FCriticalSection SaveMutex;
+    mutable TArray<TFuture<void>> SaveTasks;
+    mutable FCriticalSection WriteMutex;
+    mutable TMap<FString, uint64> WrittenGenerations;
+    mutable std::atomic<uint64> SaveGeneration{0};
+    mutable FCriticalSection PublishMutex;
+    
+    void Load(StaticLayer& Layer);
+    TSharedPtr<FStaticLoad> OpenLoad(StaticLayer& Layer);
+    void LoadHotSet(FStaticLoad& Load);
+    void LoadRemaining(FStaticLoad& Load);
+    bool AddLoadedBatch(FStaticLoad& Load, TArray<FLightLockCacheEntry>& Batch);
+    void WaitForLoads();
+    void Save();
+    void SaveLayer(StaticLayer& Layer);
+    // Load hints captured with a save snapshot and resolved to file positions by the writer.
+    struct FSaveHints
+    {
+        FLightLockAccessTracker::FSnapshot Access;
+        uint32 Frame = 0;
+        bool bHasCamera = false;
+        FVector Camera = FVector::ZeroVector;
+    };
+    void WriteSnapshot(const FString& FilePath, const FLightLockEnvironmentKey& Key, const FLightLockStaticTable::FSnapshot& Snapshot, FSaveHints& Hints, uint64 Generation, bool bPublish) const;
+    void WaitForSaves() const;
+    FString GetCacheFilePath(const FLightLockEnvironmentKey& Key) const;
+    bool IsSharedLayer(const StaticLayer& Layer) const;
+    void PublishShared(const FLightLockStaticTable::FSnapshot& Snapshot) const;
+    StaticLayer* AddStaticLayer(const FLightLockEnvironmentKey& Key);
+    void EvictIdleStaticLayers(int32 MaxLayers);
+    void RecordTrace(const FLightLockTraceEvent& Event);
+    void BumpStat(EStatCounter Counter, uint64 Amount = 1);
+    uint64 ReadStat(EStatCounter Counter) const;
+    static constexpr int32 QUERY_BATCH_CHUNK = 1024;
+    int32 QueryBatchChunk(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TArrayView<FLinearColor> OutColors, TArrayView<float> OutWeights, float Precision, bool bInterpolate);
+    // Returns false if admission rejected the store. Logged for ExportDelta unless bRecordChange is false.
+    bool StoreStatic(uint32 Hash, const FLightPath& Path, bool bRecordChange = true);
+    void StoreDynamic(uint32 Hash, const FLightPath& Path, const FVector& Position);
+    void ResetStaticLayer(StaticLayer& Layer);
+    void ResetDynamicTable();
+    struct MemoryBreakdown
+    {
+        SIZE_T StaticBytes = 0;
+        SIZE_T DynamicBytes = 0;
+        SIZE_T OverheadBytes = 0;
+        int64 StaticEntries = 0;
+        int64 DynamicEntries = 0;
+    };
+    
+    static constexpr uint32 GOVERNOR_INTERVAL_FRAMES = 120;
+    static constexpr int32 EVICTIONS_PER_FRAME = 4096;
+    static constexpr int32 MIGRATIONS_PER_FRAME = 16384;
+    // A trim scores this many random candidates per eviction, so a frame's work is bounded whatever the table size.
+    static constexpr int32 TRIM_SAMPLES_PER_EVICTION = 4;
+    
+    // Candidates drawn per dynamic store at capacity, and the stream they're drawn from (guarded by DynamicMutex).
+    static constexpr int32 DYNAMIC_VICTIM_SAMPLES = 64;
+    FRandomStream DynamicVictimRandom;
+    
+    MemoryBreakdown ComputeMemoryBreakdown() const;
+    void UpdateMemoryBudget();
+    // Evict up to MaxEvictions of the least valuable entries above the capacity limit.
+    void TrimStatic(int32 MaxEvictions);
+    void TrimDynamic(int32 MaxEvictions);
+    void AdvanceTables();
+    bool FindStaticVictim(uint32& OutHash);
+    bool FindDynamicVictim(uint32& OutHash);
+    float GetDynamicRetention(const DynamicEntry& Entry, uint32 Frame) const;
+    void EvictStatic(uint32 Hash);
+    void EvictDynamic(uint32 Hash);
     void PromoteToStatic(uint32 Hash, const FLightPath& Path);
+    // Refreshes a dynamic hit's access frame; true if it had gone unhit past the promotion threshold.
+    bool TouchDynamic(DynamicEntry& Entry, uint32 Frame) const;
     FLinearColor ApplyTemporalSmoothing(uint32 Hash, const FLinearColor& NewColor, bool bIsMiss);
 };
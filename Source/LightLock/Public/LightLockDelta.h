@@ -0,0 +1,31 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LightLockCore.h"
+
+struct FLightLockDeltaHeader
+{
+    FLightLockEnvironmentKey Environment;
+    // Hashes only match between instances hashing with the same cell size.
+    float WorldSpacePrecision = 0.01f;
+    // Exporter's change epoch at export time.
+    uint64 Epoch = 0;
+};
+
+// Wire format for static entries exchanged between instances (FLightLockCore::ExportDelta/ImportDelta).
+// Entries are sorted in Morton order so their validation positions delta-encode to a byte or two per
+// axis; normals are the hasher's 1/1000 integers, colour and weight half floats, confidence and
+// roughness bytes. The incident direction isn't sent: FLightPath::Create derives it from the normal.
+// The packed entries are then zlib-compressed.
+class LIGHTLOCK_API FLightLockDeltaCodec
+{
+public:
+    // Sorts Entries in place.
+    static void Encode(const FLightLockDeltaHeader& Header, TArray<FLightLockCacheEntry>& Entries, TArray<uint8>& OutBytes);
+    static bool Decode(TConstArrayView<uint8> Bytes, FLightLockDeltaHeader& OutHeader, TArray<FLightLockCacheEntry>& OutEntries);
+
+    // Confidence as carried on the wire, so a merge compares what both sides can represent.
+    static uint8 QuantizeConfidence(float Confidence) { return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Confidence * 255.0f), 0, 255)); }
+};
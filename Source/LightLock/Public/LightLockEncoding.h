@@ -0,0 +1,88 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Little-endian byte stream helpers shared by the compact binary formats (traces, deltas).
+namespace LightLockEncoding
+{
+    inline uint64 ZigZag(int64 Value)
+    {
+        return (static_cast<uint64>(Value) << 1) ^ static_cast<uint64>(Value >> 63);
+    }
+
+    inline int64 UnZigZag(uint64 Value)
+    {
+        return static_cast<int64>(Value >> 1) ^ -static_cast<int64>(Value & 1);
+    }
+
+    inline void WriteVarInt(TArray<uint8>& Out, uint64 Value)
+    {
+        while (Value >= 0x80)
+        {
+            Out.Add(static_cast<uint8>(Value) | 0x80);
+            Value >>= 7;
+        }
+        Out.Add(static_cast<uint8>(Value));
+    }
+
+    inline void WriteSignedVarInt(TArray<uint8>& Out, int64 Value)
+    {
+        WriteVarInt(Out, ZigZag(Value));
+    }
+
+    template<typename T>
+    inline void WriteRaw(TArray<uint8>& Out, const T& Value)
+    {
+        Out.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+    }
+
+    class FReader
+    {
+    public:
+        FReader(const uint8* InData, int64 InSize) : Cursor(InData), End(InData + InSize) {}
+
+        bool ReadVarInt(uint64& OutValue)
+        {
+            OutValue = 0;
+            for (int32 Shift = 0; Shift < 64 && Cursor < End; Shift += 7)
+            {
+                uint8 Byte = *Cursor++;
+                OutValue |= static_cast<uint64>(Byte & 0x7F) << Shift;
+                if ((Byte & 0x80) == 0) return true;
+            }
+            bError = true;
+            return false;
+        }
+
+        bool ReadSignedVarInt(int64& OutValue)
+        {
+            uint64 Raw;
+            if (!ReadVarInt(Raw)) return false;
+            OutValue = UnZigZag(Raw);
+            return true;
+        }
+
+        template<typename T>
+        bool ReadRaw(T& OutValue)
+        {
+            if (End - Cursor < static_cast<int64>(sizeof(T)))
+            {
+                bError = true;
+                return false;
+            }
+            FMemory::Memcpy(&OutValue, Cursor, sizeof(T));
+            Cursor += sizeof(T);
+            return true;
+        }
+
+        bool IsAtEnd() const { return Cursor >= End; }
+        bool IsError() const { return bError; }
+
+    private:
+        const uint8* Cursor;
+        const uint8* End;
+        bool bError = false;
+    };
+}
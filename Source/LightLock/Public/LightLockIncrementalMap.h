@@ -0,0 +1,201 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LightLockArena.h"
+#include "Templates/Function.h"
+#include "Math/RandomStream.h"
+#include <unordered_map>
+
+// Arena-backed uint32-keyed hash map that never rehashes all of its entries at once.
+// When the table fills, it is parked as the "old" table and a new one with twice the buckets takes
+// its place; nodes are then spliced across a few at a time on every insert and in bounded batches
+// through Migrate(). Until the old table drains, lookups and removals check both. Splicing relinks
+// nodes instead of copying them, so no entry moves in memory.
+// Not thread-safe: guarded by the owner's lock, like the arena it allocates from.
+template<typename ValueType>
+class TLightLockIncrementalMap
+{
+public:
+    using MapType = std::unordered_map<uint32, ValueType, std::hash<uint32>, std::equal_to<uint32>, TLightLockArenaAllocator<std::pair<const uint32, ValueType>>>;
+    using value_type = typename MapType::value_type;
+
+    // Maps an entry's key to its new key while re-keying, or returns an unset value to drop the entry.
+    using FRekeyFunction = TFunction<TOptional<uint32>(uint32 Key, ValueType& Value)>;
+
+    explicit TLightLockIncrementalMap(FLightLockArena& InArena)
+        : Arena(&InArena)
+        , Current(MakeMap())
+        , Old(MakeMap())
+    {
+    }
+
+    TLightLockIncrementalMap(const TLightLockIncrementalMap&) = delete;
+    TLightLockIncrementalMap& operator=(const TLightLockIncrementalMap&) = delete;
+
+    ValueType* Find(uint32 Key)
+    {
+        auto It = Current.find(Key);
+        if (It != Current.end()) return &It->second;
+        if (Old.empty()) return nullptr;
+        It = Old.find(Key);
+        return It != Old.end() ? &It->second : nullptr;
+    }
+
+    const ValueType* Find(uint32 Key) const
+    {
+        return const_cast<TLightLockIncrementalMap*>(this)->Find(Key);
+    }
+
+    // Like Find, but while a re-key runs only entries already moved to their new key can match: an
+    // unmigrated entry's old key is from the previous keying and may collide with a new one by chance.
+    ValueType* FindMigrated(uint32 Key)
+    {
+        if (!Rekey) return Find(Key);
+        auto It = Current.find(Key);
+        return It != Current.end() ? &It->second : nullptr;
+    }
+
+    ValueType& FindOrAdd(uint32 Key)
+    {
+        auto It = Current.find(Key);
+        if (It != Current.end()) return It->second;
+        if (IsMigrating())
+        {
+            // Two steps per insert drain the old table before the new one (sized 2x) can fill.
+            Migrate(MIGRATION_STEPS_PER_INSERT);
+            auto OldIt = Old.find(Key);
+            if (OldIt != Old.end())
+            {
+                return Current.insert(Old.extract(OldIt)).position->second;
+            }
+        }
+        else if (Current.size() >= MIN_INCREMENTAL_SIZE && Current.size() + 1 > Current.bucket_count() * Current.max_load_factor())
+        {
+            BeginMigration(Current.size() * 2, nullptr);
+        }
+        return Current.emplace(Key, ValueType()).first->second;
+    }
+
+    bool Remove(uint32 Key)
+    {
+        if (Current.erase(Key) > 0) return true;
+        return !Old.empty() && Old.erase(Key) > 0;
+    }
+
+    size_t Num() const { return Current.size() + Old.size(); }
+    bool IsEmpty() const { return Current.empty() && Old.empty(); }
+    bool IsMigrating() const { return !Old.empty(); }
+
+    // Visits every entry as Func(Key, Value). Entries still waiting to be re-keyed report their old key.
+    template<typename FuncType>
+    void ForEach(FuncType&& Func) const
+    {
+        for (const auto& Pair : Current) Func(Pair.first, Pair.second);
+        for (const auto& Pair : Old) Func(Pair.first, Pair.second);
+    }
+
+    // Visits up to NumSamples entries picked at random, unordered and possibly repeated, as Func(Key, Value).
+    template<typename FuncType>
+    void ForEachSample(int32 NumSamples, FRandomStream& Random, FuncType&& Func) const
+    {
+        const int32 Total = static_cast<int32>(Num());
+        if (Total == 0) return;
+        for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+        {
+            // Pick a table in proportion to its size, then the first entry within a few buckets of a random one.
+            const MapType& Map = Random.RandHelper(Total) < static_cast<int32>(Current.size()) ? Current : Old;
+            const size_t BucketCount = Map.bucket_count();
+            size_t Bucket = Random.GetUnsignedInt() % BucketCount;
+            for (int32 Probe = 0; Probe < SAMPLE_PROBES; ++Probe, Bucket = (Bucket + 1) % BucketCount)
+            {
+                if (Map.bucket_size(Bucket) == 0) continue;
+                auto It = Map.begin(Bucket);
+                Func(It->first, It->second);
+                break;
+            }
+        }
+    }
+
+    // Moves every entry to the key returned by Rekey, a bounded batch at a time like growth.
+    // A re-key that lands on a key already present keeps the existing entry.
+    void BeginRekey(FRekeyFunction InRekey)
+    {
+        // Only one migration runs at a time; a re-key requested meanwhile starts when it drains.
+        if (IsMigrating())
+        {
+            QueuedRekeys.Add(MoveTemp(InRekey));
+            return;
+        }
+        if (Current.empty()) return;
+        BeginMigration(Current.size() * 2, MoveTemp(InRekey));
+    }
+
+    // Splices up to MaxEntries nodes from the old table. Returns true while a migration is in progress.
+    bool Migrate(int32 MaxEntries)
+    {
+        if (Old.empty()) return false;
+        for (int32 i = 0; i < MaxEntries && !Old.empty(); ++i)
+        {
+            auto Node = Old.extract(Old.begin());
+            if (Rekey)
+            {
+                TOptional<uint32> NewKey = Rekey(Node.key(), Node.mapped());
+                if (!NewKey.IsSet()) continue;
+                Node.key() = NewKey.GetValue();
+            }
+            // A failed insert (key already present) frees the node when the result goes out of scope.
+            Current.insert(MoveTemp(Node));
+        }
+        if (!Old.empty()) return true;
+        // Drained: release the old bucket array.
+        Rekey = nullptr;
+        Old.~MapType();
+        new (&Old) MapType(MakeMap());
+        while (QueuedRekeys.Num() > 0 && !IsMigrating())
+        {
+            FRekeyFunction Next = MoveTemp(QueuedRekeys[0]);
+            QueuedRekeys.RemoveAt(0);
+            BeginRekey(MoveTemp(Next));
+        }
+        return IsMigrating();
+    }
+
+    // Call after resetting the arena: the maps' memory is gone, so abandon them instead of destroying them.
+    void ResetAfterArenaReset()
+    {
+        Rekey = nullptr;
+        QueuedRekeys.Reset();
+        new (&Current) MapType(MakeMap());
+        new (&Old) MapType(MakeMap());
+    }
+
+private:
+    // Below this size a one-step rehash is cheaper than tracking a migration.
+    static constexpr size_t MIN_INCREMENTAL_SIZE = 1024;
+    static constexpr int32 MIGRATION_STEPS_PER_INSERT = 2;
+    static constexpr int32 SAMPLE_PROBES = 8;
+
+    MapType MakeMap() const
+    {
+        return MapType(0, std::hash<uint32>(), std::equal_to<uint32>(), typename MapType::allocator_type(Arena));
+    }
+
+    void BeginMigration(size_t Capacity, FRekeyFunction InRekey)
+    {
+        Old.~MapType();
+        new (&Old) MapType(MoveTemp(Current));
+        Current.~MapType();
+        new (&Current) MapType(MakeMap());
+        Current.reserve(Capacity);
+        Rekey = MoveTemp(InRekey);
+    }
+
+    FLightLockArena* Arena;
+    MapType Current;
+    MapType Old;
+    FRekeyFunction Rekey;
+    // Re-keys requested while a migration was running, applied in order.
+    TArray<FRekeyFunction> QueuedRekeys;
+};
@@ -0,0 +1,58 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Turns a byte budget into static/dynamic entry capacities.
+// Bytes per entry are measured from the live tables, and with adaptive budgeting the split between
+// the layers follows eviction pressure and hit feedback. Platform memory trims halve the budget
+// temporarily; it recovers gradually while no further trims arrive.
+class LIGHTLOCK_API FLightLockMemoryGovernor
+{
+public:
+    struct FSample
+    {
+        SIZE_T StaticBytes = 0;
+        SIZE_T DynamicBytes = 0;
+        SIZE_T OverheadBytes = 0;
+        int64 StaticEntries = 0;
+        int64 DynamicEntries = 0;
+        uint64 StaticHits = 0;
+        uint64 DynamicHits = 0;
+        uint64 StaticEvictions = 0;
+        uint64 DynamicEvictions = 0;
+    };
+
+    FLightLockMemoryGovernor(SIZE_T InBudgetBytes, float InStaticFraction, bool bInAdaptive, SIZE_T InStaticEntryBytes, SIZE_T InDynamicEntryBytes);
+
+    void Update(const FSample& Sample);
+    void NotifyMemoryTrim() { bTrimRequested.store(true); }
+    bool IsTrimRequested() const { return bTrimRequested.load(std::memory_order_relaxed); }
+
+    int32 GetStaticCapacity() const { return StaticCapacity; }
+    int32 GetDynamicCapacity() const { return DynamicCapacity; }
+    SIZE_T GetBudgetBytes() const { return static_cast<SIZE_T>(BudgetBytes * PressureScale); }
+    float GetStaticFraction() const { return StaticFraction; }
+
+private:
+    static constexpr float FRACTION_STEP = 0.02f;
+    static constexpr float MIN_FRACTION = 0.1f;
+    static constexpr float MAX_FRACTION = 0.9f;
+    static constexpr int32 MIN_CAPACITY = 256;
+
+    void Recompute(SIZE_T OverheadBytes);
+
+    SIZE_T BudgetBytes;
+    float StaticFraction;
+    bool bAdaptive;
+    float PressureScale = 1.0f;
+    double StaticEntryBytes;
+    double DynamicEntryBytes;
+    int32 StaticCapacity = MIN_CAPACITY;
+    int32 DynamicCapacity = MIN_CAPACITY;
+    FSample Previous;
+    bool bHasPrevious = false;
+    std::atomic<bool> bTrimRequested{false};
+};
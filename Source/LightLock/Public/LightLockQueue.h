@@ -0,0 +1,86 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Bounded lock-free multi-producer / single-consumer ring buffer.
+// Producers never block: Enqueue fails when the ring is full and the caller decides what to drop.
+template<typename ElementType>
+class TLightLockMpscQueue
+{
+public:
+    explicit TLightLockMpscQueue(uint32 InCapacity)
+        : Capacity(FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(InCapacity, 2)))
+        , Mask(Capacity - 1)
+        , Slots(MakeUnique<FSlot[]>(Capacity))
+    {
+        for (uint32 i = 0; i < Capacity; ++i)
+        {
+            Slots[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool Enqueue(const ElementType& Item)
+    {
+        uint64 Pos = EnqueuePos.load(std::memory_order_relaxed);
+        FSlot* Slot = nullptr;
+        for (;;)
+        {
+            Slot = &Slots[Pos & Mask];
+            uint64 Seq = Slot->Sequence.load(std::memory_order_acquire);
+            int64 Diff = static_cast<int64>(Seq) - static_cast<int64>(Pos);
+            if (Diff == 0)
+            {
+                if (EnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (Diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                Pos = EnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        Slot->Value = Item;
+        Slot->Sequence.store(Pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Must only be called from one thread at a time.
+    bool Dequeue(ElementType& OutItem)
+    {
+        uint64 Pos = DequeuePos.load(std::memory_order_relaxed);
+        FSlot& Slot = Slots[Pos & Mask];
+        uint64 Seq = Slot.Sequence.load(std::memory_order_acquire);
+        if (static_cast<int64>(Seq) - static_cast<int64>(Pos + 1) < 0) return false;
+        OutItem = MoveTemp(Slot.Value);
+        Slot.Sequence.store(Pos + Capacity, std::memory_order_release);
+        DequeuePos.store(Pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint32 Num() const
+    {
+        uint64 Head = DequeuePos.load(std::memory_order_relaxed);
+        uint64 Tail = EnqueuePos.load(std::memory_order_relaxed);
+        return Tail > Head ? static_cast<uint32>(FMath::Min<uint64>(Tail - Head, Capacity)) : 0;
+    }
+
+    uint32 GetCapacity() const { return Capacity; }
+
+private:
+    struct FSlot
+    {
+        std::atomic<uint64> Sequence{0};
+        ElementType Value;
+    };
+
+    const uint32 Capacity;
+    const uint32 Mask;
+    TUniquePtr<FSlot[]> Slots;
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePos{0};
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> DequeuePos{0};
+};
@@ -0,0 +1,120 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/ScopeRWLock.h"
+#include "Async/Future.h"
+#include "LightLockCore.h"
+#include <atomic>
+
+// Static layer published in a named shared-memory segment so processes on one host share one copy.
+// The first process to open the segment owns it: it loads the cache file privately and publishes a packed
+// record array plus an open-addressing hash index. Other processes map it, only read it, and fall back to it
+// on static misses. Readers check the owner's pid and heartbeat and reattach (taking ownership if nobody else
+// has) when the owner exits or dies. Publishing is guarded by a seqlock generation, so a reader that races
+// a republish sees a miss rather than a torn record.
+// The owner's heartbeat runs on its own thread, so a long frame or a debugger break doesn't hand the segment
+// to a reader while the owner still writes; an owner that finds its pid replaced anyway stops publishing.
+// Segments are reference counted: the process that created one keeps it mapped while others are attached,
+// since unmapping a region its creator made also unlinks the name on some platforms (shm_unlink on Linux).
+class LIGHTLOCK_API FLightLockSharedCache
+{
+public:
+    static TUniquePtr<FLightLockSharedCache> Open(const FString& Name, uint32 RecordCapacity, const FLightLockEnvironmentKey& Environment);
+    ~FLightLockSharedCache();
+    
+    bool Find(uint32 Hash, FLightPath& OutPath) const;
+    
+    // Owner only. Readers see misses between Begin and End.
+    void BeginPublish();
+    bool Publish(uint32 Hash, const FLightPath& Path);
+    void EndPublish();
+    
+    // Call once per frame. The owner checks it still owns the segment; readers check the owner and reattach if
+    // it has gone. Returns true when this process has just become the owner and should load and publish the cache file.
+    bool Tick();
+    
+    bool IsOwner() const { return bIsOwner.load(std::memory_order_relaxed); }
+    const FLightLockEnvironmentKey& GetEnvironment() const { return Environment; }
+    int64 GetNumRecords() const;
+    SIZE_T GetMappedBytes() const { return MappedBytes; }
+    
+private:
+    static constexpr uint32 SHARED_MAGIC = 0x4C4C5348;
+    static constexpr uint32 SHARED_LAYOUT_VERSION = 2;
+    static constexpr int64 HEARTBEAT_TIMEOUT_TICKS = 30 * ETimespan::TicksPerSecond;
+    static constexpr uint32 HEARTBEAT_INTERVAL_MS = 1000;
+    static constexpr uint32 OWNER_CHECK_INTERVAL = 60;
+    
+    enum class ESegmentState : uint32
+    {
+        Active,
+        Abandoned
+    };
+    
+    struct alignas(PLATFORM_CACHE_LINE_SIZE) Header
+    {
+        std::atomic<uint32> Magic;
+        uint32 LayoutVersion;
+        uint32 RecordSize;
+        uint32 RecordCapacity;
+        uint32 SlotCount;
+        int32 TimeOfDayBucket;
+        int32 LightSetHash;
+        std::atomic<uint32> OwnerPid;
+        std::atomic<uint32> State;
+        std::atomic<uint32> Generation;
+        std::atomic<uint32> NumRecords;
+        std::atomic<int64> HeartbeatTicks;
+        // Processes with the segment mapped. Left high by a crash, which only keeps the segment alive longer.
+        std::atomic<uint32> AttachCount;
+    };
+    
+    struct Slot
+    {
+        uint32 Hash;
+        uint32 Record;
+    };
+    
+    FLightLockSharedCache(const FString& InName, uint32 InRecordCapacity, const FLightLockEnvironmentKey& InEnvironment);
+    
+    bool Attach();
+    void Detach();
+    void BindRegion(FPlatformMemory::FSharedMemoryRegion* InRegion);
+    bool TryClaimOwnership(uint32 ObservedOwner);
+    void InitializeHeader();
+    bool IsOwnerAlive() const;
+    // Drops ownership if another process has claimed the segment. Caller holds RegionLock.
+    bool VerifyOwnership();
+    void RunHeartbeat();
+    
+    FString Name;
+    uint32 RecordCapacity;
+    uint32 SlotCount;
+    uint32 SlotShift;
+    SIZE_T SlotsOffset;
+    SIZE_T RecordsOffset;
+    SIZE_T MappedBytes;
+    FLightLockEnvironmentKey Environment;
+    uint32 ProcessId;
+    
+    mutable FRWLock RegionLock;
+    FPlatformMemory::FSharedMemoryRegion* Region = nullptr;
+    Header* SegmentHeader = nullptr;
+    Slot* Slots = nullptr;
+    FLightPath* Records = nullptr;
+    // Region was created by this process, and has been counted in AttachCount.
+    bool bCreatedRegion = false;
+    bool bCounted = false;
+    // A created region Detach kept mapped for the processes still attached; reused by the next Attach.
+    FPlatformMemory::FSharedMemoryRegion* RetainedRegion = nullptr;
+    std::atomic<bool> bIsOwner{false};
+    std::atomic<bool> bStopHeartbeat{false};
+    FEvent* HeartbeatEvent = nullptr;
+    TFuture<void> HeartbeatThread;
+    uint32 TicksSinceCheck = 0;
+    uint32 PublishCount = 0;
+    uint32 PublishGeneration = 0;
+};
@@ -4,9 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Misc/ScopeRWLock.h"
 #include "LightLockCore.h"
 #include "LightLockSubsystem.generated.h"
 
+class ULevel;
+
 UCLASS()
 class LIGHTLOCK_API ULightLockSubsystem : public UGameInstanceSubsystem
 {
@@ -19,6 +22,15 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LightLock")
     bool QueryLighting(FVector Position, FVector Normal, FLinearColor& OutColor, float& OutWeight);
     
+    // Looks up many points in one call; see FLightLockCore::QueryBatch. Normals holds one normal per
+    // position or a single one for all. Returns the number of points hit.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    int32 QueryLightingBatch(const TArray<FVector>& Positions, const TArray<FVector>& Normals, TArray<FLinearColor>& OutColors, TArray<float>& OutWeights, bool bInterpolate = false);
+    
+    // Native form of QueryLightingBatch writing into caller-owned buffers, for particle and crowd systems.
+    // Safe to call from worker threads. Points are routed to their level partition's core.
+    int32 SampleLighting(TConstArrayView<FVector> Positions, TConstArrayView<FVector> Normals, TArrayView<FLinearColor> OutColors, TArrayView<float> OutWeights, bool bInterpolate = false) const;
+    
     UFUNCTION(BlueprintCallable, Category = "LightLock")
     void StoreLighting(FVector Position, FVector Normal, FLinearColor Color, float Weight = 1.0f, bool bIsStatic = false, int32 BounceCount = 1, float Confidence = 1.0f);
     
@@ -31,6 +43,10 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LightLock")
     void UpdateCamera(FVector CameraPosition, FVector CameraForward, float FOV, float FarPlane, float DeltaTime);
     
+    // Streams the rest of a loading cache outward from Position (e.g. the spawn point) once the hot set is in.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void SetLoadFocus(FVector Position);
+    
     UFUNCTION(BlueprintCallable, Category = "LightLock")
     void CullDistantEntries(FVector CameraPosition, float MaxDistance = 50000.0f);
     
@@ -49,12 +65,91 @@ public:
     UFUNCTION(BlueprintCallable, Category = "LightLock")
     void ResetStatistics();
     
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void StartTrace(int32 MaxTraceMegabytes = 64);
+    
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    bool StopTrace(const FString& FileName = TEXT("LightLock.trace"));
+    
+    // Static lighting stored or promoted in the persistent cache since SinceEpoch (0 for all), packed for
+    // another instance's ImportLightingDelta. Returns the epoch to pass next time. Deltas are refused
+    // (SinceEpoch returned unchanged, nothing packed) while level partitions are enabled.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    int64 ExportLightingDelta(int64 SinceEpoch, TArray<uint8>& OutBytes) const;
+    
+    // Merges a peer's delta into the persistent cache; existing entries are only replaced by more confident ones.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    bool ImportLightingDelta(const TArray<uint8>& Bytes);
+    
+    // File forms of the above, under Saved/LightLock/Deltas. SaveLightingDelta returns -1 if the write fails
+    // or level partitions are enabled.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    int64 SaveLightingDelta(const FString& FileName, int64 SinceEpoch = 0) const;
+    
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    bool LoadLightingDelta(const FString& FileName);
+    
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    int32 GetLevelPartitionCount() const;
+    
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void SetLightingEnvironment(FLightLockEnvironmentKey Environment, FLightLockEnvironmentKey BlendEnvironment, float BlendAlpha = 0.0f);
+    
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void PreloadLightingEnvironment(FLightLockEnvironmentKey Environment);
+    
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void ReleaseLightingEnvironment(FLightLockEnvironmentKey Environment);
+    
+    // Resizes every core's tables in place (capacities apply per partition, as at startup). Ignored while a
+    // memory budget is set.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void SetCacheCapacities(int32 StaticCapacity, int32 DynamicCapacity);
+    
+    // Switches the hashing cell size. Dynamic entries are re-keyed over the next frames; static entries are cleared.
+    UFUNCTION(BlueprintCallable, Category = "LightLock")
+    void SetWorldSpacePrecision(float Precision);
+    
+    const FLightLockConfig& GetConfiguration() const { return Configuration; }
+    
+    UFUNCTION(BlueprintPure, Category = "LightLock")
+    static FLightLockEnvironmentKey MakeLightingEnvironment(float TimeOfDayHours, int32 BucketsPerDay, const TArray<FName>& EnabledLights);
+    
     FLightLockCore* GetCore() const { return Core.Get(); }
     
+    // Core owning Position: the smallest loaded level partition containing it, else the persistent core.
+    // Partitions are released on level unload, so don't hold the pointer across frames.
+    FLightLockCore* GetCoreForPosition(const FVector& Position) const;
+    
 protected:
     UPROPERTY(EditDefaultsOnly, Category = "LightLock")
     FLightLockConfig Configuration;
     
 private:
+    struct FLevelPartition
+    {
+        TUniquePtr<FLightLockCore> Core;
+        FBox Bounds = FBox(ForceInit);
+        TWeakObjectPtr<UWorld> World;
+    };
+    
+    // Advances every core once per engine frame: drains queued stores, ages and trims the tables.
+    void OnEndFrame();
+    void OnLevelAddedToWorld(ULevel* Level, UWorld* World);
+    void OnLevelRemovedFromWorld(ULevel* Level, UWorld* World);
+    FLightLockCore* FindCoreLocked(const FVector& Position) const;
+    template<typename FunctionType>
+    void ForEachCore(FunctionType&& Function) const;
+    
     TUniquePtr<FLightLockCore> Core;
+    
+    FLightLockEnvironmentKey ActiveEnvironment;
+    FLightLockEnvironmentKey BlendEnvironment;
+    float EnvironmentBlendAlpha = 0.0f;
+    
+    mutable FRWLock PartitionLock;
+    TMap<FName, FLevelPartition> Partitions;
+    FDelegateHandle LevelAddedHandle;
+    FDelegateHandle LevelRemovedHandle;
+    FDelegateHandle EndFrameHandle;
 };
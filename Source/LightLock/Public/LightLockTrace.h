@@ -0,0 +1,77 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+enum class ELightLockTraceOp : uint8
+{
+    Query,
+    Store,
+    InvalidateRegion,
+    UpdateCamera,
+    AdvanceFrame,
+    CullDistantEntries,
+    ClearDynamic,
+    ClearAll,
+    Num
+};
+
+struct FLightLockTraceEvent
+{
+    ELightLockTraceOp Op = ELightLockTraceOp::AdvanceFrame;
+    uint32 Hash = 0;
+    FVector Position = FVector::ZeroVector;
+    FVector Normal = FVector::UpVector;
+    FLinearColor Color = FLinearColor::Black;
+    float Weight = 1.0f;
+    float Confidence = 1.0f;
+    uint8 BounceCount = 1;
+    bool bIsStatic = false;
+    bool bHit = false;
+    FBox Region = FBox(ForceInit);
+    float FOV = 0.0f;
+    float FarPlane = 0.0f;
+    float DeltaTime = 0.0f;
+    float MaxDistance = 0.0f;
+};
+
+// Ring-buffered recorder of FLightLockCore calls.
+// Events are packed into self-contained chunks (positions are delta-encoded against the previous
+// event in the same chunk), so the oldest chunk can be dropped when the byte budget is exceeded.
+class LIGHTLOCK_API FLightLockTraceRecorder
+{
+public:
+    FLightLockTraceRecorder(int64 InMaxBytes, float InWorldSpacePrecision);
+
+    void Record(const FLightLockTraceEvent& Event);
+    bool SaveToFile(const FString& FilePath) const;
+    int64 GetRecordedBytes() const;
+    int64 GetDroppedChunks() const;
+
+private:
+    static constexpr int32 CHUNK_SIZE = 64 * 1024;
+
+    void BeginChunk();
+
+    mutable FCriticalSection Mutex;
+    TArray<TArray<uint8>> Chunks;
+    int64 MaxBytes;
+    int64 DroppedChunks = 0;
+    float WorldSpacePrecision;
+    int64 PrevPosition[3] = {};
+    int64 PrevCameraPosition[3] = {};
+};
+
+class LIGHTLOCK_API FLightLockTraceReader
+{
+public:
+    bool LoadFromFile(const FString& FilePath);
+    bool ReadAll(TArray<FLightLockTraceEvent>& OutEvents) const;
+    float GetWorldSpacePrecision() const { return WorldSpacePrecision; }
+
+private:
+    TArray<TArray<uint8>> Chunks;
+    float WorldSpacePrecision = 0.01f;
+};
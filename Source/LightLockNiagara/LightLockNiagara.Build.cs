@@ -0,0 +1,30 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+using UnrealBuildTool;
+
+public class LightLockNiagara : ModuleRules
+{
+    public LightLockNiagara(ReadOnlyTargetRules Target) : base(Target)
+    {
+        PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+        
+        PublicDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "Core",
+                "CoreUObject",
+                "Niagara",
+            }
+        );
+        
+        PrivateDependencyModuleNames.AddRange(
+            new string[]
+            {
+                "Engine",
+                "NiagaraCore",
+                "VectorVM",
+                "LightLock",
+            }
+        );
+    }
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#include "NiagaraDataInterfaceLightLock.h"
+#include "LightLockSubsystem.h"
+#include "NiagaraSystemInstance.h"
+#include "NiagaraTypes.h"
+#include "VectorVM.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Modules/ModuleManager.h"
+#if !UE_VERSION_OLDER_THAN(5, 1, 0)
+#include "Math/LargeWorldRenderPosition.h"
+#endif
+
+static const FName SampleLightingName(TEXT("SampleLighting"));
+
+struct FNDILightLockInstanceData
+{
+    TWeakObjectPtr<ULightLockSubsystem> Subsystem;
+    FNiagaraSystemInstance* SystemInstance = nullptr;
+};
+
+void UNiagaraDataInterfaceLightLock::PostInitProperties()
+{
+    Super::PostInitProperties();
+    if (HasAnyFlags(RF_ClassDefaultObject))
+    {
+        ENiagaraTypeRegistryFlags Flags = ENiagaraTypeRegistryFlags::AllowAnyVariable | ENiagaraTypeRegistryFlags::AllowParameter;
+        FNiagaraTypeRegistry::Register(FNiagaraTypeDefinition(GetClass()), Flags);
+    }
+}
+
+bool UNiagaraDataInterfaceLightLock::InitPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance)
+{
+    FNDILightLockInstanceData* InstanceData = new (PerInstanceData) FNDILightLockInstanceData();
+    InstanceData->SystemInstance = SystemInstance;
+    // No game instance (e.g. an editor preview) just means every particle misses.
+    UWorld* World = SystemInstance->GetWorld();
+    UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+    InstanceData->Subsystem = GameInstance ? GameInstance->GetSubsystem<ULightLockSubsystem>() : nullptr;
+    return true;
+}
+
+void UNiagaraDataInterfaceLightLock::DestroyPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance)
+{
+    static_cast<FNDILightLockInstanceData*>(PerInstanceData)->~FNDILightLockInstanceData();
+}
+
+int32 UNiagaraDataInterfaceLightLock::PerInstanceDataSize() const
+{
+    return sizeof(FNDILightLockInstanceData);
+}
+
+#if UE_VERSION_OLDER_THAN(5, 3, 0)
+void UNiagaraDataInterfaceLightLock::GetFunctions(TArray<FNiagaraFunctionSignature>& OutFunctions)
+#elif WITH_EDITORONLY_DATA
+void UNiagaraDataInterfaceLightLock::GetFunctionsInternal(TArray<FNiagaraFunctionSignature>& OutFunctions) const
+#endif
+#if UE_VERSION_OLDER_THAN(5, 3, 0) || WITH_EDITORONLY_DATA
+{
+    FNiagaraFunctionSignature Signature;
+    Signature.Name = SampleLightingName;
+    Signature.bMemberFunction = true;
+    Signature.bRequiresContext = false;
+    Signature.bSupportsGPU = false;
+    Signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition(GetClass()), TEXT("LightLock")));
+#if UE_VERSION_OLDER_THAN(5, 1, 0)
+    Signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec3Def(), TEXT("Position")));
+#else
+    Signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetPositionDef(), TEXT("Position")));
+#endif
+    Signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec3Def(), TEXT("Normal")));
+    Signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetColorDef(), TEXT("Color")));
+    Signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Weight")));
+    Signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetBoolDef(), TEXT("Hit")));
+    OutFunctions.Add(Signature);
+}
+#endif
+
+void UNiagaraDataInterfaceLightLock::GetVMExternalFunction(const FVMExternalFunctionBindingInfo& BindingInfo, void* InstanceData, FVMExternalFunction& OutFunc)
+{
+    if (BindingInfo.Name == SampleLightingName)
+    {
+        OutFunc = FVMExternalFunction::CreateUObject(this, &UNiagaraDataInterfaceLightLock::SampleLighting);
+    }
+}
+
+bool UNiagaraDataInterfaceLightLock::Equals(const UNiagaraDataInterface* Other) const
+{
+    if (!Super::Equals(Other)) return false;
+    return CastChecked<const UNiagaraDataInterfaceLightLock>(Other)->bInterpolate == bInterpolate;
+}
+
+bool UNiagaraDataInterfaceLightLock::CopyToInternal(UNiagaraDataInterface* Destination) const
+{
+    if (!Super::CopyToInternal(Destination)) return false;
+    CastChecked<UNiagaraDataInterfaceLightLock>(Destination)->bInterpolate = bInterpolate;
+    return true;
+}
+
+void UNiagaraDataInterfaceLightLock::SampleLighting(FVectorVMExternalFunctionContext& Context)
+{
+    VectorVM::FUserPtrHandler<FNDILightLockInstanceData> InstanceData(Context);
+    FNDIInputParam<FVector3f> InPosition(Context);
+    FNDIInputParam<FVector3f> InNormal(Context);
+    FNDIOutputParam<FLinearColor> OutColor(Context);
+    FNDIOutputParam<float> OutWeight(Context);
+    FNDIOutputParam<bool> OutHit(Context);
+    
+    const int32 NumInstances = Context.GetNumInstances();
+    FMemMark Mark(FMemStack::Get());
+    TArray<FVector, TMemStackAllocator<>> Positions;
+    TArray<FVector, TMemStackAllocator<>> Normals;
+    TArray<FLinearColor, TMemStackAllocator<>> Colors;
+    TArray<float, TMemStackAllocator<>> Weights;
+    Positions.SetNumUninitialized(NumInstances);
+    Normals.SetNumUninitialized(NumInstances);
+    Colors.SetNumUninitialized(NumInstances);
+    Weights.SetNumUninitialized(NumInstances);
+    
+#if UE_VERSION_OLDER_THAN(5, 1, 0)
+    const FVector TileOffset = FVector::ZeroVector;
+#else
+    // Niagara positions are relative to the system's large-world tile; the cache is keyed in world space.
+    const FVector TileOffset = InstanceData->SystemInstance ? FVector(InstanceData->SystemInstance->GetLWCTile()) * FLargeWorldRenderScalar::GetTileSize() : FVector::ZeroVector;
+#endif
+    for (int32 i = 0; i < NumInstances; ++i)
+    {
+        Positions[i] = FVector(InPosition.GetAndAdvance()) + TileOffset;
+        Normals[i] = FVector(InNormal.GetAndAdvance());
+    }
+    
+    ULightLockSubsystem* Subsystem = InstanceData->Subsystem.Get();
+    if (Subsystem)
+    {
+        Subsystem->SampleLighting(Positions, Normals, Colors, Weights, bInterpolate);
+    }
+    for (int32 i = 0; i < NumInstances; ++i)
+    {
+        const bool bHit = Subsystem && Weights[i] > 0.0f;
+        OutColor.SetAndAdvance(bHit ? Colors[i] : FLinearColor::Black);
+        OutWeight.SetAndAdvance(bHit ? Weights[i] : 0.0f);
+        OutHit.SetAndAdvance(bHit);
+    }
+}
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, LightLockNiagara)
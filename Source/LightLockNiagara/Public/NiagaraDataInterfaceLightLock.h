@@ -0,0 +1,46 @@
+// Copyright (c) 2025 Chasen Pietryga. Licensed under MIT License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NiagaraDataInterface.h"
+#include "Misc/EngineVersionComparison.h"
+#include "NiagaraDataInterfaceLightLock.generated.h"
+
+// Samples the LightLock cache for every particle of a CPU emitter. Each VM batch goes to
+// ULightLockSubsystem::SampleLighting as one call, so particles cost a bulk lookup instead of a
+// Blueprint call each. GPU emitters aren't supported: the cache lives in CPU memory.
+//
+// SampleLighting(Position, Normal) -> Color, Weight, Hit
+//   Position is a simulation position (large-world tiles are resolved here). Hit is set when the
+//   sample carries weight; missed particles get black with zero weight.
+UCLASS(EditInlineNew, Category = "Lighting", CollapseCategories, meta = (DisplayName = "LightLock Cache"))
+class LIGHTLOCKNIAGARA_API UNiagaraDataInterfaceLightLock : public UNiagaraDataInterface
+{
+    GENERATED_BODY()
+
+public:
+    // Blend the 8 cache cells around each particle instead of reading the one it falls in.
+    UPROPERTY(EditAnywhere, Category = "LightLock")
+    bool bInterpolate = false;
+    
+    virtual void PostInitProperties() override;
+    
+    virtual bool CanExecuteOnTarget(ENiagaraSimTarget Target) const override { return Target == ENiagaraSimTarget::CPUSim; }
+    virtual bool InitPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance) override;
+    virtual void DestroyPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance) override;
+    virtual int32 PerInstanceDataSize() const override;
+    virtual void GetVMExternalFunction(const FVMExternalFunctionBindingInfo& BindingInfo, void* InstanceData, FVMExternalFunction& OutFunc) override;
+    virtual bool Equals(const UNiagaraDataInterface* Other) const override;
+
+protected:
+#if UE_VERSION_OLDER_THAN(5, 3, 0)
+    virtual void GetFunctions(TArray<FNiagaraFunctionSignature>& OutFunctions) override;
+#elif WITH_EDITORONLY_DATA
+    virtual void GetFunctionsInternal(TArray<FNiagaraFunctionSignature>& OutFunctions) const override;
+#endif
+    virtual bool CopyToInternal(UNiagaraDataInterface* Destination) const override;
+
+private:
+    void SampleLighting(FVectorVMExternalFunctionContext& Context);
+};